@@ -45,10 +45,66 @@ enum jscon_type {
 };
 
 
+/* jscon_parse_ext() flags */
+enum jscon_parse_flags {
+    JSCON_PARSE_DEFAULT    = 0,
+    /* keys and strings point to the given buffer, which is modified in
+     *  place and must outlive the parsed item */
+    JSCON_PARSE_INSITU     = 1 << 0,
+    /* jscon_parse_many() delivers records as soon as they're parsed */
+    JSCON_PARSE_UNORDERED  = 1 << 1,
+    /* keys are shared with every other document parsed with this flag,
+     *  through a process-wide pool, and must not be modified */
+    JSCON_PARSE_INTERN     = 1 << 2,
+};
+
+
 /* forwarding, definition at jscon-common.h */
 typedef struct jscon_item_s jscon_item_t;
+/* forwarding, definition at jscon-arena.c */
+typedef struct jscon_arena_s jscon_arena_t;
+/* forwarding, definition at jscon-parser.c */
+typedef struct jscon_parser_s jscon_parser_t;
+/* forwarding, definition at jscon-parser.c */
+typedef struct jscon_doc_s jscon_doc_t;
+/* forwarding, definition at jscon-tape.c */
+typedef struct jscon_tape_s jscon_tape_t;
+/* read-only reference to a value of a tape, passed by value */
+typedef struct jscon_view_s {
+    const jscon_tape_t *tape; /* NULL if it refers to nothing */
+    size_t pos;
+} jscon_view_t;
+/* jscon_iter_init() modes */
+enum jscon_iter_mode {
+    JSCON_ITER_ALL         = 0, /* item and all of its nested items, in preorder */
+    JSCON_ITER_COMPOSITE, /* item and its nested objects and arrays, in preorder */
+    JSCON_ITER_BRANCH, /* item's branches only */
+};
+/* external iterator, meant to be stack allocated. it holds the whole
+ *  traversal state, so the tree isn't written to while being walked */
+typedef struct jscon_iter_s {
+    jscon_item_t *root; /* the item being walked, its subtree isn't left */
+    jscon_item_t *next; /* item to be returned by the next step, NULL if done */
+    enum jscon_iter_mode mode;
+} jscon_iter_t;
 /* jscon_parser() callback */
 typedef jscon_item_t* (jscon_cb)(jscon_item_t*);
+/* jscon_parse_many() callback, root is released once it returns */
+typedef void (jscon_many_cb)(jscon_item_t *root, void *data);
+/* jscon_parse_sax() event callbacks, any of them may be NULL. keys and
+ *  strings point inside of the given buffer (undecoded and not NUL
+ *  terminated), numbers give i_number if type is JSCON_INTEGER */
+typedef struct jscon_sax_s {
+    void (*start_object)(void *data);
+    void (*end_object)(void *data);
+    void (*start_array)(void *data);
+    void (*end_array)(void *data);
+    void (*key)(const char *key, size_t len, void *data);
+    void (*string)(const char *string, size_t len, void *data);
+    void (*number)(enum jscon_type type, long long i_number, double d_number, void *data);
+    void (*boolean)(bool boolean, void *data);
+    void (*null)(void *data);
+} jscon_sax_t;
 
 
 #ifdef __cplusplus
@@ -69,24 +125,57 @@ jscon_item_t *jscon_string(const char *key, char *string);
  * clean up jscon item and global allocated keys */
 void jscon_destroy(jscon_item_t *item);
 
+/* JSCON ARENA
+ * bump allocate items in large chunks, which are all
+ *  released at once by jscon_arena_destroy() */
+jscon_arena_t* jscon_arena_init(void);
+void jscon_arena_destroy(jscon_arena_t *arena);
+
 /* JSCON DECODING
  * parse buffer and returns a jscon item */
 jscon_item_t* jscon_parse(char *buffer);
+jscon_item_t* jscon_parse_arena(jscon_arena_t *arena, char *buffer);
+jscon_item_t* jscon_parse_ext(char *buffer, jscon_arena_t *arena, int flags);
+jscon_item_t* jscon_parse_len(const char *buffer, size_t len);
+jscon_item_t* jscon_parse_file(const char *path);
+jscon_item_t* jscon_parse_parallel(const char *buffer, size_t len, int nthreads);
+void jscon_parse_many(const char *buffer, size_t len, int nthreads, int flags, jscon_many_cb *callback, void *data);
 jscon_cb* jscon_parse_cb(jscon_cb *new_cb);
+/* free the key pool of JSCON_PARSE_INTERN, no document using it may be alive */
+void jscon_intern_reset(void);
+/* parse into the storage of a previous document, which is reused */
+jscon_doc_t* jscon_doc_init(void);
+void jscon_doc_destroy(jscon_doc_t *doc);
+jscon_item_t* jscon_parse_into(jscon_doc_t *doc, const char *buffer, size_t len);
+long jscon_validate(const char *buffer, size_t len);
+/* report parse events to callbacks, without building any item */
+long jscon_parse_sax(const char *buffer, size_t len, const jscon_sax_t *sax, void *data);
+/* incrementally parse input fed in chunks */
+jscon_parser_t* jscon_parser_new(jscon_arena_t *arena);
+void jscon_parser_feed(jscon_parser_t *parser, const char *chunk, size_t len);
+jscon_item_t* jscon_parser_finish(jscon_parser_t *parser);
 /* only parse json values from given parameters */
 void jscon_scanf(char *buffer, char *format, ...);
+void jscon_scanf_len(const char *buffer, size_t len, char *format, ...);
  
 /* JSCON ENCODING */
 char* jscon_stringify(jscon_item_t *root, enum jscon_type type);
 
 /* JSCON UTILITIES */
 size_t jscon_size(const jscon_item_t* item);
+void jscon_build_index(jscon_item_t *item);
+bool jscon_reserve(jscon_item_t *item, size_t n);
 jscon_item_t* jscon_append(jscon_item_t *item, jscon_item_t *new_branch);
 jscon_item_t* jscon_dettach(jscon_item_t *item);
 void jscon_delete(jscon_item_t *item, const char *key);
 jscon_item_t* jscon_iter_composite_r(jscon_item_t *item, jscon_item_t **p_current_item);
+/* preorder successor, until the end of the subtree the walk started at.
+ *  walks can't be nested within a thread (use jscon_iter_init() for that) */
 jscon_item_t* jscon_iter_next(jscon_item_t* item);
+void jscon_iter_init(jscon_iter_t *iter, jscon_item_t *item, enum jscon_iter_mode mode);
+jscon_item_t* jscon_iter_step(jscon_iter_t *iter);
 jscon_item_t* jscon_clone(jscon_item_t *item);
+jscon_item_t* jscon_clone_arena(jscon_arena_t *arena, jscon_item_t *item);
 char* jscon_typeof(const jscon_item_t* item);
 char* jscon_strdup(const jscon_item_t* item);
 char* jscon_strcpy(char *dest, const jscon_item_t* item);
@@ -95,6 +184,23 @@ int jscon_keycmp(const jscon_item_t* item, const char *key);
 int jscon_doublecmp(const jscon_item_t* item, const double d_number);
 int jscon_intcmp(const jscon_item_t* item, const long long i_number);
 
+/* JSCON TAPE
+ * compact read-only document, its values are accessed through views */
+jscon_tape_t* jscon_tape_parse(const char *buffer, size_t len);
+void jscon_tape_destroy(jscon_tape_t *tape);
+jscon_view_t jscon_tape_root(const jscon_tape_t *tape);
+size_t jscon_view_size(jscon_view_t view);
+jscon_view_t jscon_view_first(jscon_view_t view);
+jscon_view_t jscon_view_next(jscon_view_t view);
+jscon_view_t jscon_view_get_branch(jscon_view_t view, const char *key);
+jscon_view_t jscon_view_get_byindex(jscon_view_t view, size_t index);
+enum jscon_type jscon_view_get_type(jscon_view_t view);
+const char* jscon_view_get_key(jscon_view_t view);
+bool jscon_view_get_boolean(jscon_view_t view);
+const char* jscon_view_get_string(jscon_view_t view, size_t *p_len);
+double jscon_view_get_double(jscon_view_t view);
+long long jscon_view_get_integer(jscon_view_t view);
+
 /* JSCON GETTERS */
 jscon_item_t* jscon_get_root(jscon_item_t* item);
 jscon_item_t* jscon_get_branch(jscon_item_t* item, const char *key);
@@ -103,7 +209,11 @@ jscon_item_t* jscon_get_parent(const jscon_item_t* item);
 jscon_item_t* jscon_get_byindex(const jscon_item_t* item, const size_t index);
 long jscon_get_index(const jscon_item_t* item, const char *key);
 enum jscon_type jscon_get_type(const jscon_item_t* item);
+/* an array element key is generated into a thread local buffer, which
+ *  the next jscon_get_key() call of the same thread overwrites. use
+ *  jscon_get_key_r() to keep it, or to compare two keys */
 char* jscon_get_key(const jscon_item_t* item);
+char* jscon_get_key_r(const jscon_item_t* item, char buf[], size_t size);
 bool jscon_get_boolean(const jscon_item_t* item);
 char* jscon_get_string(const jscon_item_t* item);
 double jscon_get_double(const jscon_item_t* item);
@@ -23,126 +23,296 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <time.h>
 #include <assert.h>
 
 #include "hashtable.h"
 
+/* dictionary keys are copied on insertion, and so are matched by
+ *  contents, unless looked up with the entry's own copy */
+#define KEY_EQ(k1,k2) ((k1) == (k2) || 0 == strcmp(k1,k2))
+
+/* grow once more than 7/8 of the slots are taken */
+#define MAX_LOAD(num_slot) ((num_slot) - (num_slot) / 8)
+#define MIN_SLOT 4
+
+static uint64_t _hashtable_seed;
+
+/* the seed is drawn once per process, so that the slot keys land at
+ *  can't be predicted (and flooded) from outside */
+static uint64_t
+_hashtable_get_seed(void)
+{
+    uint64_t seed = __atomic_load_n(&_hashtable_seed, __ATOMIC_RELAXED);
+    if (0 != seed) return seed;
+
+    FILE *f_random = fopen("/dev/urandom", "rb");
+    if (NULL != f_random){
+        if (1 != fread(&seed, sizeof seed, 1, f_random)){
+            seed = 0;
+        }
+        fclose(f_random);
+    }
+    /* fallback, at least differs between runs */
+    seed ^= (uint64_t)time(NULL) * 0x9e3779b97f4a7c15ULL ^ (uint64_t)(uintptr_t)&seed;
+    seed |= 1; /* 0 means unset */
+
+    /* another thread may have got there first, either seed works */
+    __sync_bool_compare_and_swap(&_hashtable_seed, 0, seed);
+    return __atomic_load_n(&_hashtable_seed, __ATOMIC_RELAXED);
+}
+
+/* multiply to 128 bits and fold, each input bit affects every output bit */
+static inline uint64_t
+_hashtable_mix(uint64_t a, uint64_t b)
+{
+#ifdef __SIZEOF_INT128__
+    __uint128_t r = (__uint128_t)a * b;
+    return (uint64_t)r ^ (uint64_t)(r >> 64);
+#else
+    uint64_t a_lo = (uint32_t)a, a_hi = a >> 32;
+    uint64_t b_lo = (uint32_t)b, b_hi = b >> 32;
+    uint64_t lo_lo = a_lo * b_lo, hi_lo = a_hi * b_lo;
+    uint64_t lo_hi = a_lo * b_hi, hi_hi = a_hi * b_hi;
+    uint64_t cross = (lo_lo >> 32) + (uint32_t)hi_lo + lo_hi;
+    uint64_t upper = hi_hi + (hi_lo >> 32) + (cross >> 32);
+    return ((cross << 32) | (uint32_t)lo_lo) ^ upper;
+#endif
+}
+
+static inline uint64_t
+_hashtable_read64(const char *p){
+    uint64_t v;
+    memcpy(&v, p, sizeof v);
+    return v;
+}
+
+static inline uint64_t
+_hashtable_read32(const char *p){
+    uint32_t v;
+    memcpy(&v, p, sizeof v);
+    return v;
+}
+
+#define HASH_K0 0xa0761d6478bd642fULL
+#define HASH_K1 0xe7037ed1a0b428dbULL
+
+/* seeded multiply-fold hash (in the spirit of wyhash), keys are read
+ *  8 bytes at a time, and those of up to 16 bytes with overlapping
+ *  loads instead of a byte loop */
+static uint64_t
+_hashtable_genhash(const char *key, const size_t len, const uint64_t seed)
+{
+    uint64_t h = _hashtable_mix(seed ^ HASH_K0, HASH_K1);
+    uint64_t a, b;
+
+    if (len <= 16){
+        if (len >= 4){
+            const size_t mid = (len >> 3) << 2;
+            a = (_hashtable_read32(key) << 32) | _hashtable_read32(key + mid);
+            b = (_hashtable_read32(key + len - 4) << 32) | _hashtable_read32(key + len - 4 - mid);
+        } else if (len > 0){
+            a = ((uint64_t)(unsigned char)key[0] << 16)
+                | ((uint64_t)(unsigned char)key[len >> 1] << 8)
+                | (unsigned char)key[len - 1];
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = len;
+        const char *p = key;
+        while (i > 16){
+            h = _hashtable_mix(_hashtable_read64(p) ^ HASH_K1, _hashtable_read64(p + 8) ^ h);
+            p += 16;
+            i -= 16;
+        }
+        a = _hashtable_read64(p + i - 16);
+        b = _hashtable_read64(p + i - 8);
+    }
+
+    return _hashtable_mix(_hashtable_mix(a ^ HASH_K1, b ^ h) ^ len, HASH_K0 ^ h);
+}
+
+/* hash key with the process seed, for tables built outside of this
+ *  file that need the same flooding resistance */
+uint64_t
+hashtable_genhash(const char *key, const size_t len){
+    return _hashtable_genhash(key, len, _hashtable_get_seed());
+}
+
 hashtable_t*
 hashtable_init()
 {
     hashtable_t *new_hashtable = calloc(1, sizeof *new_hashtable);
     assert(NULL != new_hashtable);
 
+    new_hashtable->seed = _hashtable_get_seed();
+
     return new_hashtable;
 }
 
-void
-hashtable_destroy(hashtable_t *hashtable)
+hashtable_t*
+hashtable_init_alloc(void *(*calloc_cb)(size_t, void*), void *data)
 {
-    for (size_t i=0; i < hashtable->num_bucket; ++i){
-        if (NULL == hashtable->bucket[i])
-            continue;
+    hashtable_t *new_hashtable = (*calloc_cb)(sizeof *new_hashtable, data);
+    assert(NULL != new_hashtable);
 
-        hashtable_entry_t *entry = hashtable->bucket[i];
-        hashtable_entry_t *entry_prev;
-        while (NULL != entry){
-            entry_prev = entry;
-            entry = entry->next;
+    new_hashtable->seed = _hashtable_get_seed();
+    new_hashtable->calloc_cb = calloc_cb;
+    new_hashtable->data = data;
 
-            free(entry_prev);
-            entry_prev = NULL;
-        }
+    return new_hashtable;
+}
+
+static void*
+_hashtable_calloc(hashtable_t *hashtable, size_t size)
+{
+    if (NULL != hashtable->calloc_cb){
+        return (*hashtable->calloc_cb)(size, hashtable->data);
     }
-    free(hashtable->bucket);
-    hashtable->bucket = NULL;
+    return calloc(1, size);
+}
+
+void
+hashtable_destroy(hashtable_t *hashtable)
+{
+    /* memory is released by the allocator's owner */
+    if (NULL != hashtable->calloc_cb) return;
+
+    free(hashtable->slot);
+    hashtable->slot = NULL;
     
     free(hashtable);
     hashtable = NULL;
 }
 
-static size_t
-_hashtable_genhash(const char *key, const size_t num_bucket)
-{
-    size_t slot = 0;
-    size_t key_len = strlen(key);
+/* how far an entry at slot i is from its home slot */
+#define PROBE_DIST(hashtable, entry, i) \
+    (((i) - (entry)->hash) & ((hashtable)->num_slot - 1))
 
-    /* @todo learn different implementations and improvements */
-    for (size_t i=0; i < key_len; ++i){
-        slot = slot * 37 + key[i];
+/* place an entry that is known not to be in the table yet */
+static void
+_hashtable_insert(hashtable_t *hashtable, hashtable_entry_t entry)
+{
+    const size_t mask = hashtable->num_slot - 1;
+
+    size_t i = entry.hash & mask;
+    size_t dist = 0;
+    while (NULL != hashtable->slot[i].key){
+        size_t slot_dist = PROBE_DIST(hashtable, &hashtable->slot[i], i);
+        if (slot_dist < dist){ /* take from the rich, keep on with it */
+            hashtable_entry_t tmp = hashtable->slot[i];
+            hashtable->slot[i] = entry;
+            entry = tmp;
+            dist = slot_dist;
+        }
+        i = (i + 1) & mask;
+        ++dist;
     }
-
-    slot %= num_bucket;
-
-    return slot;
+    hashtable->slot[i] = entry;
 }
 
-static hashtable_entry_t*
-_hashtable_pair(const char *key, const void *value)
+/* (re)allocate the slots to fit num_entry entries, those already set
+ *  are moved over */
+static void
+_hashtable_resize(hashtable_t *hashtable, size_t num_entry)
 {
-    hashtable_entry_t *new_entry = calloc(1, sizeof *new_entry);
-    assert(NULL != new_entry);
+    size_t num_slot = MIN_SLOT;
+    while (MAX_LOAD(num_slot) < num_entry){
+        num_slot *= 2;
+    }
+    assert(num_slot - 1 <= UINT32_MAX); /* slot must fit the stored hash */
 
-    new_entry->key = (char*)key;
-    new_entry->value = (void*)value;
+    hashtable_entry_t *old_slot = hashtable->slot;
+    size_t old_num_slot = hashtable->num_slot;
 
-    return new_entry;
+    hashtable->slot = _hashtable_calloc(hashtable, num_slot * sizeof *hashtable->slot);
+    assert(NULL != hashtable->slot);
+    hashtable->num_slot = num_slot;
+
+    for (size_t i=0; i < old_num_slot; ++i){
+        if (NULL != old_slot[i].key){
+            _hashtable_insert(hashtable, old_slot[i]);
+        }
+    }
+
+    if (NULL == hashtable->calloc_cb){
+        free(old_slot);
+    }
 }
 
+/* make room for kNum_index entries before the table has to grow */
 void
-hashtable_build(hashtable_t *hashtable, const size_t num_index)
+hashtable_build(hashtable_t *hashtable, const size_t kNum_index)
 {
-    hashtable->num_bucket = num_index;
+    if (NULL != hashtable->slot && kNum_index <= MAX_LOAD(hashtable->num_slot)) return;
 
-    hashtable->bucket = calloc(1, hashtable->num_bucket * sizeof *hashtable->bucket);
-    assert(NULL != hashtable->bucket);
+    _hashtable_resize(hashtable, (kNum_index > hashtable->len) ? kNum_index : hashtable->len);
 }
 
-hashtable_entry_t*
-_hashtable_get_entry(hashtable_t *hashtable, const char *key)
+/* return key's slot index, or num_slot if its not set */
+static size_t
+_hashtable_find(hashtable_t *hashtable, const char *key, size_t key_len, uint32_t hash)
 {
-    if (0 == hashtable->num_bucket) return NULL;
+    if (0 == hashtable->len) return hashtable->num_slot;
 
-    size_t slot = _hashtable_genhash(key, hashtable->num_bucket);
+    const size_t mask = hashtable->num_slot - 1;
 
-    hashtable_entry_t *entry = hashtable->bucket[slot];
-    while (NULL != entry){ /* try to find key and return it */
-        if (0 == strcmp(entry->key, key)){
-            return entry;
+    size_t i = hash & mask;
+    for (size_t dist=0; NULL != hashtable->slot[i].key; ++dist){
+        hashtable_entry_t *entry = &hashtable->slot[i];
+        /* the key would have displaced an entry this close to home */
+        if (PROBE_DIST(hashtable, entry, i) < dist) break;
+
+        if (entry->hash == hash && entry->key_len == key_len
+            && (entry->key == key || 0 == memcmp(entry->key, key, key_len)))
+        {
+            return i;
         }
-        entry = entry->next;
+        i = (i + 1) & mask;
     }
 
-    return NULL;
+    return hashtable->num_slot;
 }
 
 void*
 hashtable_get(hashtable_t *hashtable, const char *key)
 {
-    hashtable_entry_t *entry = _hashtable_get_entry(hashtable, key);
-    return (NULL != entry) ? entry->value : NULL;
+    size_t key_len = strlen(key);
+    uint32_t hash = (uint32_t)_hashtable_genhash(key, key_len, hashtable->seed);
+
+    size_t i = _hashtable_find(hashtable, key, key_len, hash);
+    return (i < hashtable->num_slot) ? hashtable->slot[i].value : NULL;
 }
 
+/* set value to key if its not set already, returns the value key is
+ *  set to */
 void*
 hashtable_set(hashtable_t *hashtable, const char *key, const void *value)
 {
-    size_t slot = _hashtable_genhash(key, hashtable->num_bucket);
+    size_t key_len = strlen(key);
+    assert(key_len <= UINT32_MAX);
+    uint32_t hash = (uint32_t)_hashtable_genhash(key, key_len, hashtable->seed);
 
-    hashtable_entry_t *entry = hashtable->bucket[slot];
-    if (NULL == entry){
-        hashtable->bucket[slot] = _hashtable_pair(key, value);
-        return hashtable->bucket[slot]->value;
+    size_t i = _hashtable_find(hashtable, key, key_len, hash);
+    if (i < hashtable->num_slot){
+        return hashtable->slot[i].value;
     }
 
-    hashtable_entry_t *entry_prev;
-    while (NULL != entry){
-        if (0 == strcmp(entry->key, key)){
-            return entry->value;
-        }
-        entry_prev = entry;
-        entry = entry->next;
+    if (hashtable->len + 1 > MAX_LOAD(hashtable->num_slot)){
+        _hashtable_resize(hashtable, 2 * (hashtable->len + 1));
     }
 
-    entry_prev->next = _hashtable_pair(key, value);
+    hashtable_entry_t new_entry = {
+        .key = (char*)key,
+        .value = (void*)value,
+        .hash = hash,
+        .key_len = (uint32_t)key_len,
+    };
+    _hashtable_insert(hashtable, new_entry);
+    ++hashtable->len;
 
     return (void*)value;
 }
@@ -150,29 +320,73 @@ hashtable_set(hashtable_t *hashtable, const char *key, const void *value)
 void
 hashtable_remove(hashtable_t *hashtable, const char *key)
 {
-    if (0 == hashtable->num_bucket) return;
+    size_t key_len = strlen(key);
+    uint32_t hash = (uint32_t)_hashtable_genhash(key, key_len, hashtable->seed);
+
+    size_t i = _hashtable_find(hashtable, key, key_len, hash);
+    if (i == hashtable->num_slot) return;
+
+    /* shift the entries that follow back by one, until one that is
+     *  already at its home slot, so that no probe is cut short */
+    const size_t mask = hashtable->num_slot - 1;
+    size_t next = (i + 1) & mask;
+    while (NULL != hashtable->slot[next].key
+           && 0 != PROBE_DIST(hashtable, &hashtable->slot[next], next))
+    {
+        hashtable->slot[i] = hashtable->slot[next];
+        i = next;
+        next = (next + 1) & mask;
+    }
+    memset(&hashtable->slot[i], 0, sizeof hashtable->slot[i]);
+    --hashtable->len;
+}
 
-    size_t slot = _hashtable_genhash(key, hashtable->num_bucket);
+/* copy hashtable slots as they are, allocated with calloc_cb if given.
+ *  the seed is shared by the whole process, so every entry stays at
+ *  the same slot without being rehashed. entries still point to the
+ *  original keys and values, for the caller to swap */
+hashtable_t*
+hashtable_clone(hashtable_t *hashtable, void *(*calloc_cb)(size_t, void*), void *data)
+{
+    hashtable_t *new_hashtable = (NULL != calloc_cb)
+                                    ? hashtable_init_alloc(calloc_cb, data)
+                                    : hashtable_init();
 
-    hashtable_entry_t *entry = hashtable->bucket[slot];
-    hashtable_entry_t *entry_prev = NULL;
-    while (NULL != entry){
-        if (0 == strcmp(entry->key, key)){
-            if (NULL != entry_prev){
-                entry_prev->next = entry->next; 
-            } else {
-                hashtable->bucket[slot] = entry->next; 
-            }
+    if (NULL != hashtable->slot){
+        new_hashtable->slot = _hashtable_calloc(new_hashtable, hashtable->num_slot * sizeof *hashtable->slot);
+        assert(NULL != new_hashtable->slot);
 
-            entry->key = NULL;
+        memcpy(new_hashtable->slot, hashtable->slot, hashtable->num_slot * sizeof *hashtable->slot);
+    }
+    new_hashtable->num_slot = hashtable->num_slot;
+    new_hashtable->len = hashtable->len;
 
-            free(entry);
-            entry = NULL;
-            return;
+    return new_hashtable;
+}
+
+/* seeded like the hashtable's, as dictionary keys may come from
+ *  untrusted input too */
+static size_t
+_dictionary_genhash(const char *key, const size_t num_bucket){
+    return hashtable_genhash(key, strlen(key)) % num_bucket;
+}
+
+static dictionary_entry_t*
+_dictionary_get_entry(dictionary_t *dictionary, const char *key)
+{
+    if (0 == dictionary->num_bucket) return NULL;
+
+    size_t slot = _dictionary_genhash(key, dictionary->num_bucket);
+
+    dictionary_entry_t *entry = dictionary->bucket[slot];
+    while (NULL != entry){ /* try to find key and return it */
+        if (KEY_EQ(entry->key, key)){
+            return entry;
         }
-        entry_prev = entry;
         entry = entry->next;
     }
+
+    return NULL;
 }
 
 dictionary_t*
@@ -217,6 +431,15 @@ dictionary_destroy(dictionary_t *dictionary)
     dictionary = NULL;
 }
 
+void
+dictionary_build(dictionary_t *dictionary, const size_t num_index)
+{
+    dictionary->num_bucket = num_index;
+
+    dictionary->bucket = calloc(1, dictionary->num_bucket * sizeof *dictionary->bucket);
+    assert(NULL != dictionary->bucket);
+}
+
 static dictionary_entry_t*
 _dictionary_pair(const char *key, const void *value, void (*free_cb)(void*))
 {
@@ -237,7 +460,7 @@ _dictionary_pair(const char *key, const void *value, void (*free_cb)(void*))
 void*
 dictionary_set(dictionary_t *dictionary, const char *key, const void *value, void (*free_cb)(void*))
 {
-    size_t slot = _hashtable_genhash(key, dictionary->num_bucket);
+    size_t slot = _dictionary_genhash(key, dictionary->num_bucket);
 
     dictionary_entry_t *entry = dictionary->bucket[slot];
     if (NULL == entry){
@@ -249,7 +472,7 @@ dictionary_set(dictionary_t *dictionary, const char *key, const void *value, voi
 
     dictionary_entry_t *entry_prev;
     while (NULL != entry){
-        if (0 == strcmp(entry->key, key)){
+        if (KEY_EQ(entry->key, key)){
             if (entry->free_cb && NULL != entry->value){
                 (*entry->free_cb)(entry->value);
             }
@@ -274,12 +497,12 @@ dictionary_remove(dictionary_t *dictionary, const char *key)
 {
     if (0 == dictionary->num_bucket) return;
 
-    size_t slot = _hashtable_genhash(key, dictionary->num_bucket);
+    size_t slot = _dictionary_genhash(key, dictionary->num_bucket);
 
     dictionary_entry_t *entry = dictionary->bucket[slot];
     dictionary_entry_t *entry_prev = NULL;
     while (NULL != entry){
-        if (0 == strcmp(entry->key, key)){
+        if (KEY_EQ(entry->key, key)){
             if (NULL != entry_prev){
                 entry_prev->next = entry->next; 
             } else {
@@ -306,11 +529,17 @@ dictionary_remove(dictionary_t *dictionary, const char *key)
     }
 }
 
+void*
+dictionary_get(dictionary_t *dictionary, const char *key)
+{
+    dictionary_entry_t *entry = _dictionary_get_entry(dictionary, key);
+    return (NULL != entry) ? entry->value : NULL;
+}
+
 void*
 dictionary_replace(dictionary_t *dictionary, const char *key, void *new_value)
 {
-    /* this works, because dictionary and hashtable structs are aligned */
-    dictionary_entry_t *entry = (dictionary_entry_t*)_hashtable_get_entry((hashtable_t*)dictionary, key);
+    dictionary_entry_t *entry = _dictionary_get_entry(dictionary, key);
 
     if (entry->free_cb && NULL != entry->value){
         (*entry->free_cb)(entry->value);
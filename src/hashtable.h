@@ -23,23 +23,39 @@
 #ifndef HASHTABLE_H_
 #define HASHTABLE_H_
 
+#include <stdint.h>
+
+/* open addressing with robin hood probing, an entry is kept close to
+ *  its home slot (hash & mask) by displacing entries that are closer
+ *  to theirs. a NULL key marks an empty slot */
 typedef struct hashtable_entry_s {
     char *key; //this entry key tag
     void *value; //this entry value
-    struct hashtable_entry_s *next; //next entry pointer for when keys don't match
+    uint32_t hash; //low bits of the key hash, compared before the key
+    uint32_t key_len; //key length, compared before the key
 } hashtable_entry_t;
 
 typedef struct hashtable_s {
-    hashtable_entry_t **bucket;
-    size_t num_bucket;
+    hashtable_entry_t *slot;
+    size_t num_slot; //power of two
+    size_t len; //amount of entries set
+    uint64_t seed; //keys are hashed with a random seed
+
+    /* custom allocator, if set the memory is owned (and released) by
+     *  whoever the callback gets it from */
+    void *(*calloc_cb)(size_t size, void *data);
+    void *data;
 } hashtable_t;
 
+uint64_t hashtable_genhash(const char *key, const size_t len);
 hashtable_t* hashtable_init();
+hashtable_t* hashtable_init_alloc(void *(*calloc_cb)(size_t, void*), void *data);
 void hashtable_destroy(hashtable_t *hashtable);
 void hashtable_build(hashtable_t *hashtable, const size_t kNum_index);
 void *hashtable_get(hashtable_t *hashtable, const char *key);
 void *hashtable_set(hashtable_t *hashtable, const char *key, const void *value);
 void hashtable_remove(hashtable_t *hashtable, const char *key);
+hashtable_t* hashtable_clone(hashtable_t *hashtable, void *(*calloc_cb)(size_t, void*), void *data);
 
 typedef struct dictionary_entry_s {
     char *key; //this entry key tag
@@ -60,8 +76,8 @@ typedef struct dictionary_s {
 dictionary_t* dictionary_init();
 void dictionary_destroy(dictionary_t *dictionary);
 
-#define dictionary_build(dict, num_index) hashtable_build((hashtable_t*)dict, num_index)
-#define dictionary_get(dict, key) hashtable_get((hashtable_t*)dict, key)
+void dictionary_build(dictionary_t *dictionary, const size_t num_index);
+void *dictionary_get(dictionary_t *dictionary, const char *key);
 void *dictionary_set(dictionary_t *dictionary, const char *key, const void *value, void (*free_cb)(void*));
 void dictionary_remove(dictionary_t *dictionary, const char *key);
 void *dictionary_replace(dictionary_t *dictionary, const char *key, void *new_value);
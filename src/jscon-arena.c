@@ -0,0 +1,228 @@
+/*
+ * Copyright (c) 2020 Lucas Müller
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <libjscon.h>
+#include "jscon-common.h"
+
+#include "debug.h"
+
+
+#define ARENA_ALIGN sizeof(max_align_t)
+#define ARENA_MIN_CHUNK ((size_t)4096)
+#define ARENA_MAX_CHUNK ((size_t)1 << 20)
+
+/* JSCON ARENA CHUNK
+ *  memory is bump-allocated from the most recent chunk, once it can't
+ *  fit a request a bigger chunk is created and linked to the previous
+ *  ones, so that they can all be released at once
+ *      next: previously created chunk
+ *      size: amount of usable bytes at data
+ *      used: amount of bytes already handed out */
+struct jscon_chunk_s {
+    struct jscon_chunk_s *next;
+    size_t size;
+    size_t used;
+    max_align_t data[];
+};
+
+struct jscon_arena_s {
+    struct jscon_chunk_s *chunk; /* current chunk */
+    size_t next_size; /* size of the next chunk to be created */
+};
+
+jscon_arena_t*
+jscon_arena_init(void)
+{
+    jscon_arena_t *new_arena = calloc(1, sizeof *new_arena);
+    if (NULL == new_arena) return NULL;
+
+    new_arena->next_size = ARENA_MIN_CHUNK;
+
+    return new_arena;
+}
+
+/* release every chunk, and every item allocated from them */
+void
+jscon_arena_destroy(jscon_arena_t *arena)
+{
+    if (NULL == arena) return;
+
+    struct jscon_chunk_s *chunk = arena->chunk;
+    struct jscon_chunk_s *chunk_next;
+    while (NULL != chunk){
+        chunk_next = chunk->next;
+        free(chunk);
+        chunk = chunk_next;
+    }
+
+    free(arena);
+    arena = NULL;
+}
+
+static struct jscon_chunk_s*
+_jscon_arena_new_chunk(size_t size)
+{
+    struct jscon_chunk_s *new_chunk = malloc(sizeof *new_chunk + size);
+    ASSERT_S(NULL != new_chunk, jscon_strerror(JSCON_EXT__OUT_MEM, new_chunk));
+
+    new_chunk->size = size;
+    new_chunk->used = 0;
+
+    return new_chunk;
+}
+
+/* forget every allocation while keeping the memory around, chunks are
+ *  merged into a single one that fits all of their contents, so that
+ *  refilling the arena alike won't have to allocate again */
+void
+Jscon_arena_reset(jscon_arena_t *arena)
+{
+    struct jscon_chunk_s *chunk = arena->chunk;
+    if (NULL == chunk) return;
+
+    if (NULL == chunk->next){
+        chunk->used = 0;
+        return;
+    }
+
+    size_t total_size = 0;
+    struct jscon_chunk_s *chunk_next;
+    while (NULL != chunk){
+        chunk_next = chunk->next;
+        total_size += chunk->size;
+        free(chunk);
+        chunk = chunk_next;
+    }
+
+    arena->chunk = _jscon_arena_new_chunk(total_size);
+    arena->chunk->next = NULL;
+}
+
+/* return uninitialized memory from arena */
+static void*
+_jscon_arena_bump(jscon_arena_t *arena, size_t size)
+{
+    size = (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+
+    struct jscon_chunk_s *chunk = arena->chunk;
+    if (NULL != chunk && size <= chunk->size - chunk->used){
+        void *ptr = (char*)chunk->data + chunk->used;
+        chunk->used += size;
+        return ptr;
+    }
+
+    if (size > arena->next_size / 2){
+        /* too big to share a chunk, give it a dedicated one that is
+         *  linked behind the current chunk, so its space isn't wasted */
+        struct jscon_chunk_s *new_chunk = _jscon_arena_new_chunk(size);
+        new_chunk->used = size;
+        if (NULL != chunk){
+            new_chunk->next = chunk->next;
+            chunk->next = new_chunk;
+        } else {
+            new_chunk->next = NULL;
+            arena->chunk = new_chunk;
+        }
+        return new_chunk->data;
+    }
+
+    struct jscon_chunk_s *new_chunk = _jscon_arena_new_chunk(arena->next_size);
+    new_chunk->next = chunk;
+    new_chunk->used = size;
+    arena->chunk = new_chunk;
+
+    if (arena->next_size < ARENA_MAX_CHUNK){
+        arena->next_size *= 2;
+    }
+
+    return new_chunk->data;
+}
+
+/* works like calloc() if arena is NULL, otherwise memory is zeroed
+ *  and taken from arena */
+void*
+Jscon_alloc(jscon_arena_t *arena, size_t size)
+{
+    if (NULL == arena){
+        void *ptr = calloc(1, size);
+        ASSERT_S(NULL != ptr, jscon_strerror(JSCON_EXT__OUT_MEM, ptr));
+        return ptr;
+    }
+
+    return memset(_jscon_arena_bump(arena, size), 0, size);
+}
+
+/* works like realloc() if arena is NULL, otherwise the contents are
+ *  copied to a new arena block (the old one is released alongside
+ *  the arena) */
+void*
+Jscon_realloc(jscon_arena_t *arena, void *ptr, size_t old_size, size_t new_size)
+{
+    if (NULL == arena){
+        void *tmp = realloc(ptr, new_size);
+        ASSERT_S(NULL != tmp, jscon_strerror(JSCON_EXT__OUT_MEM, tmp));
+        return tmp;
+    }
+
+    void *tmp = _jscon_arena_bump(arena, new_size);
+    if (NULL != ptr){
+        memcpy(tmp, ptr, (old_size < new_size) ? old_size : new_size);
+    }
+    return tmp;
+}
+
+/* works like strndup() if arena is NULL */
+char*
+Jscon_strndup(jscon_arena_t *arena, const char *src, size_t len)
+{
+    char *dest = (NULL == arena) ? malloc(len+1) : _jscon_arena_bump(arena, len+1);
+    ASSERT_S(NULL != dest, jscon_strerror(JSCON_EXT__OUT_MEM, dest));
+
+    memcpy(dest, src, len);
+    dest[len] = '\0';
+
+    return dest;
+}
+
+/* same as Jscon_strndup(), but src escape sequences are decoded
+ *  (check Jscon_unescape_string()) */
+char*
+Jscon_strndup_unescape(jscon_arena_t *arena, const char *src, size_t len)
+{
+    char *dest = (NULL == arena) ? malloc(len+1) : _jscon_arena_bump(arena, len+1);
+    ASSERT_S(NULL != dest, jscon_strerror(JSCON_EXT__OUT_MEM, dest));
+
+    Jscon_unescape_string(dest, src, len);
+
+    return dest;
+}
+
+/* hashtable allocation callback */
+void*
+Jscon_arena_calloc_cb(size_t size, void *data){
+    return Jscon_alloc(data, size);
+}
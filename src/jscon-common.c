@@ -25,43 +25,68 @@
 #include <stdarg.h>
 #include <string.h>
 #include <ctype.h>
+#include <stdint.h>
 
 #include <libjscon.h>
 #include "jscon-common.h"
 
-#include "strscpy.h"
 #include "debug.h"
 
 
-/* reentrant hashtable linking function */
+/* build the object's hashtable index, this is done lazily at
+ *  the first key lookup (arrays don't need one) */
 void
-Jscon_composite_link_r(jscon_item_t *item, jscon_composite_t **p_last_accessed_comp)
+Jscon_composite_build(jscon_item_t *item)
 {
-    ASSERT_S(IS_COMPOSITE(item), jscon_strerror(JSCON_EXT__NOT_COMPOSITE, item));
+    ASSERT_S(JSCON_OBJECT == item->type, jscon_strerror(JSCON_EXT__NOT_COMPOSITE, item));
+    ASSERT_S(NULL == item->comp->hashtable, jscon_strerror(JSCON_INT__NOT_FREED, item->comp->hashtable));
 
-    jscon_composite_t *last_accessed_comp = *p_last_accessed_comp;
-    if (NULL != last_accessed_comp){
-        last_accessed_comp->next = item->comp; /* item is not root */
-        item->comp->prev = last_accessed_comp;
-    }
+    item->comp->hashtable = (NULL != item->comp->arena)
+                              ? hashtable_init_alloc(&Jscon_arena_calloc_cb, item->comp->arena)
+                              : hashtable_init();
+    ASSERT_S(NULL != item->comp->hashtable, jscon_strerror(JSCON_EXT__OUT_MEM, item->comp->hashtable));
 
-    last_accessed_comp = item->comp;
+    hashtable_build(item->comp->hashtable, item->comp->num_branch); /* grows by itself on further expansions */
 
-    *p_last_accessed_comp = last_accessed_comp;
+    for (size_t i=0; i < item->comp->num_branch; ++i){
+        Jscon_composite_set(item->comp->branch[i]->key, item->comp->branch[i]);
+    }
 }
 
-void
-Jscon_composite_build(jscon_item_t *item)
+/* array elements keys are implicit, its numerical key is its position */
+static jscon_item_t*
+_jscon_array_get(const char *key, jscon_item_t *item)
 {
-    ASSERT_S(IS_COMPOSITE(item), jscon_strerror(JSCON_EXT__NOT_COMPOSITE, item));
+    /* only accept decimal keys without leading zeroes */
+    if ('0' == key[0] && '\0' != key[1]) return NULL;
 
-    hashtable_build(item->comp->hashtable, 2 + (1.3 * item->comp->num_branch)); /* 30% size increase to account for future expansions, and a default bucket size of 2 */
+    size_t index = 0;
+    const char *p_digit = key;
+    do {
+        if (!isdigit(*p_digit)) return NULL;
+        if (index > (SIZE_MAX - 9) / 10) return NULL; /* overflow */
 
-    item->comp->p_item = item;
+        index = 10 * index + (*p_digit - '0');
+    } while ('\0' != *++p_digit);
 
+    return (index < item->comp->num_branch) ? item->comp->branch[index] : NULL;
+}
+
+/* small objects keys are compared one by one, which is cheaper than
+ *  building and probing a hashtable for them */
+static jscon_item_t*
+_jscon_object_scan(const char *key, jscon_item_t *item)
+{
+    jscon_item_t **branch = item->comp->branch;
     for (size_t i=0; i < item->comp->num_branch; ++i){
-        Jscon_composite_set(item->comp->branch[i]->key, item->comp->branch[i]);
+        const char *branch_key = branch[i]->key;
+        if (branch_key == key
+            || (branch_key[0] == key[0] && STREQ(branch_key, key)))
+        {
+            return branch[i];
+        }
     }
+    return NULL;
 }
 
 jscon_item_t*
@@ -69,7 +94,18 @@ Jscon_composite_get(const char *key, jscon_item_t *item)
 {
     if (!IS_COMPOSITE(item)) return NULL;
 
+    if (JSCON_ARRAY == item->type){
+        return _jscon_array_get(key, item);
+    }
+
     jscon_composite_t *comp = item->comp;
+    if (NULL == comp->hashtable){
+        if (comp->num_branch <= MAX_SCAN_BRANCH){
+            return _jscon_object_scan(key, item);
+        }
+        Jscon_composite_build(item);
+    }
+
     return hashtable_get(comp->hashtable, key);
 }
 
@@ -82,121 +118,247 @@ Jscon_composite_set(const char *key, jscon_item_t *item)
     return hashtable_set(parent_comp->hashtable, key, item);
 }
 
-/* remake hashtable on functions that deal with increasing branches */
+/* remove item from its parent hashtable, if its been built. with
+ *  duplicate keys only the first is indexed, a later duplicate isn't
+ *  put in its place */
 void
-Jscon_composite_remake(jscon_item_t *item)
+Jscon_composite_unset(jscon_item_t *item)
 {
-    hashtable_destroy(item->comp->hashtable);
+    ASSERT_S(!IS_ROOT(item), "Can't remove from parent hashtable if Item is root");
 
-    item->comp->hashtable = hashtable_init();
-    ASSERT_S(NULL != item->comp->hashtable, jscon_strerror(JSCON_EXT__OUT_MEM, item->comp->hashtable));
+    jscon_composite_t *parent_comp = item->parent->comp;
+    if (NULL == parent_comp->hashtable || NULL == item->key) return;
 
-    Jscon_composite_build(item);
+    if (item == hashtable_get(parent_comp->hashtable, item->key)){
+        hashtable_remove(parent_comp->hashtable, item->key);
+    }
 }
 
+/* the branch array starts empty, and is grown by the parser as
+    new branches are found, the hashtable is built on demand */
 jscon_composite_t*
-Jscon_decode_composite(char **p_buffer, size_t n_branch){
-    jscon_composite_t *new_comp = calloc(1, sizeof *new_comp);
-    ASSERT_S(NULL != new_comp, jscon_strerror(JSCON_EXT__OUT_MEM, new_comp));
-
-    new_comp->hashtable = hashtable_init(); 
-    ASSERT_S(NULL != new_comp->hashtable, jscon_strerror(JSCON_EXT__OUT_MEM, new_comp->hashtable));
-
-    new_comp->branch = malloc((1+n_branch) * sizeof(jscon_item_t*));
-    ASSERT_S(NULL != new_comp->branch, jscon_strerror(JSCON_EXT__OUT_MEM, new_comp->branch));
+Jscon_decode_composite(char **p_buffer, jscon_arena_t *arena){
+    jscon_composite_t *new_comp = Jscon_alloc(arena, sizeof *new_comp);
+    new_comp->arena = arena;
 
     ++*p_buffer; /* skips composite's '{' or '[' delim */
 
     return new_comp;
 }
 
+/* find string boundaries without allocating anything, return its first
+ *  char address and store its length at p_len. p_plain, if given, is
+ *  set to whether the contents are ASCII without escape sequences, and
+ *  therefore don't need to be decoded (check Jscon_unescape_string()) */
 char*
-Jscon_decode_string(char **p_buffer)
+Jscon_scan_string(char **p_buffer, size_t *p_len, bool *p_plain)
 {
     char *start = *p_buffer;
     ASSERT_S('\"' == *start, jscon_strerror(JSCON_EXT__INVALID_STRING, start)); /* makes sure a string is given */
 
-    char *end = ++start;
-    while (('\0' != *end) && ('\"' != *end)){
-        if ('\\' == *end++){ /* skips escaped characters */
-            ++end;
+    /* most strings end before any char that needs decoding */
+    char *end = Jscon_find_plain_end(++start);
+    bool plain = ('\"' == *end);
+    if (!plain){
+        /* jump straight to the next double quotes or escape sequence */
+        end = Jscon_find_token(end, '\"', '\\', '\\');
+        while ('\\' == *end && '\0' != end[1]){ /* skips escaped characters */
+            end = Jscon_find_token(end + 2, '\"', '\\', '\\');
         }
     }
     ASSERT_S('\"' == *end, jscon_strerror(JSCON_EXT__INVALID_STRING, end)); /* makes sure a string is given */
 
     *p_buffer = end + 1; /* skips double quotes buffer position */
+    *p_len = end - start;
+    if (NULL != p_plain){
+        *p_plain = plain;
+    }
 
-    char *set_str = strndup(start, end-start);
-    ASSERT_S(NULL != set_str, jscon_strerror(JSCON_EXT__OUT_MEM, set_str));
+    return start;
+}
 
-    return set_str;
+/* length of the well-formed UTF-8 sequence at str (RFC 3629), or 0 if
+ *  it's ill-formed or cut short by end. overlong forms, surrogates and
+ *  code points past U+10FFFF are ill-formed */
+size_t
+Jscon_utf8_length(const char *str, const char *end)
+{
+    const unsigned char *s = (const unsigned char*)str;
+    size_t avail = end - str;
+
+#define IS_CONT(c) (0x80 == ((c) & 0xC0))
+    if (s[0] < 0x80) return 1;
+    if (s[0] < 0xC2) return 0; /* continuation byte or overlong */
+    if (s[0] < 0xE0){
+        return (avail >= 2 && IS_CONT(s[1])) ? 2 : 0;
+    }
+    if (s[0] < 0xF0){
+        if (avail < 3 || !IS_CONT(s[1]) || !IS_CONT(s[2])) return 0;
+        if (0xE0 == s[0] && s[1] < 0xA0) return 0; /* overlong */
+        if (0xED == s[0] && s[1] >= 0xA0) return 0; /* surrogate */
+        return 3;
+    }
+    if (s[0] < 0xF5){
+        if (avail < 4 || !IS_CONT(s[1]) || !IS_CONT(s[2]) || !IS_CONT(s[3])) return 0;
+        if (0xF0 == s[0] && s[1] < 0x90) return 0; /* overlong */
+        if (0xF4 == s[0] && s[1] >= 0x90) return 0; /* past U+10FFFF */
+        return 4;
+    }
+    return 0;
+#undef IS_CONT
 }
 
-void
-Jscon_decode_static_string(char **p_buffer, const long len, const long offset, char set_str[])
+/* value of the 4 hex digits at str, or -1 if any isn't one */
+static long
+_jscon_decode_hex4(const char *str)
 {
-    char *start = *p_buffer;
-    ASSERT_S('\"' == *start, jscon_strerror(JSCON_EXT__INVALID_STRING, start)); /* makes sure a string is given */
+    long value = 0;
+    for (int i=0; i < 4; ++i){
+        int c = (unsigned char)str[i];
+        if (c >= '0' && c <= '9')
+            value = value * 16 + (c - '0');
+        else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f')
+            value = value * 16 + ((c | 0x20) - 'a' + 10);
+        else
+            return -1;
+    }
+    return value;
+}
 
-    char *end = ++start;
-    while (('\0' != *end) && ('\"' != *end)){
-        if ('\\' == *end++){ /* skips escaped characters */
-            ++end;
+/* decode the \uXXXX escape at *p_src, and the low surrogate following
+ *  it if its a high one, as UTF-8 into *p_dest. surrogates that aren't
+ *  paired can't be encoded, and are replaced by U+FFFD */
+static void
+_jscon_unescape_unicode(char **p_dest, const char **p_src, const char *end)
+{
+    const char *src = *p_src;
+    long code = (end - src >= 6) ? _jscon_decode_hex4(src + 2) : -1;
+    ASSERT_S(-1 != code, jscon_strerror(JSCON_EXT__INVALID_STRING, (void*)src));
+    src += 6;
+
+    if (code >= 0xD800 && code <= 0xDBFF){
+        long low = (end - src >= 6 && '\\' == src[0] && 'u' == src[1])
+                     ? _jscon_decode_hex4(src + 2) : -1;
+        if (low >= 0xDC00 && low <= 0xDFFF){
+            code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+            src += 6;
+        } else {
+            code = 0xFFFD;
         }
+    } else if (code >= 0xDC00 && code <= 0xDFFF){
+        code = 0xFFFD;
     }
-    ASSERT_S('\"' == *end, jscon_strerror(JSCON_EXT__INVALID_STRING, end)); /* makes sure a string is given */
-
-    *p_buffer = end + 1; /* skips double quotes buffer position */
 
-    ASSERT_S(len > (strlen(set_str) + end-start), jscon_strerror(JSCON_INT__OVERFLOW, set_str));
+    /* never longer than the escape sequence itself */
+    unsigned char *dest = (unsigned char*)*p_dest;
+    if (code < 0x80){
+        *dest++ = code;
+    } else if (code < 0x800){
+        *dest++ = 0xC0 | (code >> 6);
+        *dest++ = 0x80 | (code & 0x3F);
+    } else if (code < 0x10000){
+        *dest++ = 0xE0 | (code >> 12);
+        *dest++ = 0x80 | ((code >> 6) & 0x3F);
+        *dest++ = 0x80 | (code & 0x3F);
+    } else {
+        *dest++ = 0xF0 | (code >> 18);
+        *dest++ = 0x80 | ((code >> 12) & 0x3F);
+        *dest++ = 0x80 | ((code >> 6) & 0x3F);
+        *dest++ = 0x80 | (code & 0x3F);
+    }
 
-    strscpy(set_str + offset, start, (end-start)+1);
+    *p_dest = (char*)dest;
+    *p_src = src;
 }
 
-double
-Jscon_decode_double(char **p_buffer)
+/* decode the escape sequences of the len bytes long string contents at
+ *  src into dest, checking that it's well-formed UTF-8, and NUL
+ *  terminate it. plain runs are copied in bulk by Jscon_copy_plain().
+ *  dest may be src itself, as decoding never grows a string. returns
+ *  the decoded length */
+size_t
+Jscon_unescape_string(char *dest, const char *src, size_t len)
 {
-    char *start = *p_buffer;
-    char *end = start;
-
-    /* 1st STEP: check for a minus sign and skip it */
-    if ('-' == *end){
-        ++end; /* skips minus sign */
+    const char *end = src + len;
+    char *start = dest;
+
+    while (1){
+        /* decoding in place, nothing to be moved until an escape */
+        size_t n = (dest == src) ? (size_t)(Jscon_find_escape(src, end) - src)
+                                 : Jscon_copy_plain(dest, src, end);
+        dest += n;
+        src += n;
+        if (src == end) break;
+
+        if ('\\' == *src){
+            ASSERT_S(end - src >= 2, jscon_strerror(JSCON_EXT__INVALID_STRING, (void*)src));
+            switch (src[1]){
+            case '\"': *dest++ = '\"'; break;
+            case '\\': *dest++ = '\\'; break;
+            case '/': *dest++ = '/'; break;
+            case 'b': *dest++ = '\b'; break;
+            case 'f': *dest++ = '\f'; break;
+            case 'n': *dest++ = '\n'; break;
+            case 'r': *dest++ = '\r'; break;
+            case 't': *dest++ = '\t'; break;
+            case 'u':
+                _jscon_unescape_unicode(&dest, &src, end);
+                continue;
+            default:
+                ERROR("%s", jscon_strerror(JSCON_EXT__INVALID_STRING, (void*)src));
+            }
+            src += 2;
+        } else if ((signed char)*src >= 0){
+            *dest++ = *src++; /* control char, taken as is */
+        } else {
+            /* non-ASCII text comes in runs of multibyte chars, mixed with
+                ASCII gaps too short to be worth a vector scan */
+            size_t num_ascii = 0;
+            while (src < end && '\\' != *src && num_ascii < 16){
+                if ((signed char)*src >= 0){
+                    *dest++ = *src++;
+                    ++num_ascii;
+                    continue;
+                }
+
+                n = Jscon_utf8_length(src, end);
+                ASSERT_S(0 != n, jscon_strerror(JSCON_EXT__INVALID_STRING, (void*)src));
+                do {
+                    *dest++ = *src++;
+                } while (--n);
+                num_ascii = 0;
+            }
+        }
     }
 
-    /* 2nd STEP: skips until a non digit char found */
-    ASSERT_S(isdigit(*end), jscon_strerror(JSCON_EXT__INVALID_NUMBER, end)); /* interrupt if char isn't digit */
-    while (isdigit(*++end))
-        continue; /* skips while char is digit */
+    *dest = '\0';
 
-    /* 3rd STEP: if non-digit char is not a comma then it must be
-        an integer*/
-    if ('.' == *end){
-        while (isdigit(*++end))
-            continue;
-    }
+    return dest - start;
+}
 
-    /* 4th STEP: if exponent found skips its tokens */
-    if (('e' == *end) || ('E' == *end)){
-        ++end;
-        if (('+' == *end) || ('-' == *end)){ 
-            ++end;
-        }
-        ASSERT_S(isdigit(*end), jscon_strerror(JSCON_EXT__INVALID_NUMBER, end)); /* interrupt if char isn't digit */
-        while (isdigit(*++end))
-            continue;
-    }
+char*
+Jscon_decode_string(char **p_buffer)
+{
+    size_t len;
+    bool plain;
+    char *start = Jscon_scan_string(p_buffer, &len, &plain);
 
-    /* 5th STEP: convert string to double and return its value */
-    char numstr[MAX_INTEGER_DIG];
-    strscpy(numstr, start, ((size_t)(end-start+1) < sizeof(numstr)) ? (size_t)(end-start+1) : sizeof(numstr));
+    if (plain){
+        return Jscon_strndup(NULL, start, len);
+    }
+    return Jscon_strndup_unescape(NULL, start, len);
+}
 
-    double set_double;
-    sscanf(numstr,"%lf",&set_double);
+void
+Jscon_decode_static_string(char **p_buffer, const long len, const long offset, char set_str[])
+{
+    size_t str_len;
+    char *start = Jscon_scan_string(p_buffer, &str_len, NULL);
+    char *end = start + str_len;
 
-    *p_buffer = end; /* skips entire length of number */
+    ASSERT_S(len > (strlen(set_str) + end-start), jscon_strerror(JSCON_INT__OVERFLOW, set_str));
 
-    return set_double;
+    Jscon_unescape_string(set_str + offset, start, end-start);
 }
 
 bool
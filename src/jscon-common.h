@@ -34,6 +34,8 @@
 #define JSCON_VERSION "0.0"
 
 #define MAX_INTEGER_DIG 20 /* ULLONG_MAX maximum amt of digits possible */
+#define MAX_NESTING_DEPTH 4096 /* maximum nesting jscon_validate() can track */
+#define MAX_SCAN_BRANCH 8 /* objects up to this size are looked up without a hashtable */
 
 typedef enum jscon_errcode
 {
@@ -67,11 +69,14 @@ char *__jscon_strerror(jscon_errcode code, char codetag[], void *where, char ent
 
 #define IN_RANGE(n,lo,hi) (((n) > (lo)) && ((n) < (hi)))
 
+/* whether d is integral and within long long range */
 #define DOUBLE_IS_INTEGER(d) \
-    ((d) <= LLONG_MIN || (d) >= LLONG_MAX || (d) == (long long)(d))
+    ((d) >= (double)LLONG_MIN && (d) < -(double)LLONG_MIN \
+     && (d) == (long long)(d))
 
-#define IS_BLANK_CHAR(c) (isspace(c) || iscntrl(c))
-#define CONSUME_BLANK_CHARS(str) for( ; IS_BLANK_CHAR(*str) ; ++str)
+/* locale independent, matches space, DEL and the control chars */
+#define IS_BLANK_CHAR(c) ((unsigned char)(c) - 1u < 32u || 127 == (c))
+#define CONSUME_BLANK_CHARS(str) ((str) = Jscon_skip_blank(str))
 
 #define IS_COMPOSITE(item) ((item) && jscon_typecmp(item, JSCON_OBJECT|JSCON_ARRAY))
 #define IS_EMPTY_COMPOSITE(item) (IS_COMPOSITE(item) && 0 == jscon_size(item))
@@ -87,38 +92,57 @@ char *__jscon_strerror(jscon_errcode code, char codetag[], void *where, char ent
  *  include a jscon_composite_t struct with the following attributes:
  *      branch: for sorting through object's properties/array elements
  *      num_branch: amount of enumerable properties/elements contained
- *      last_accessed_branch: simulate stack trace by storing the last
- *          accessed branch address. this is used for movement 
- *          functions that require state to be preserved between 
- *          calls, while also adhering to tree traversal rules. 
- *          (check public.c jscon_iter_next() for example)
- *      hashtable: easy reference to its key-value pairs
- *      p_item: reference to the item the composite is part of
- *      next: points to next composite
- *      prev: points to previous composite */
+ *      cap_branch: amount of branches that fit before branch has to grow
+ *      num_stale: amount of branches removed since every branch index
+ *          was last known to be right, 0 if they all are
+ *      stale_branch: branches from this position on may have a stale
+ *          index (check jscon-public.c _jscon_branch_index())
+ *      hashtable: easy reference to its key-value pairs, NULL until
+ *          the first key lookup, or for as long as the object is
+ *          small enough to be scanned (check Jscon_composite_get())
+ *      arena: arena the composite was allocated from, NULL if heap */
 typedef struct jscon_composite_s {
     struct jscon_item_s **branch;
     size_t num_branch;
-    size_t last_accessed_branch;
+    size_t cap_branch;
+    size_t num_stale;
+    size_t stale_branch;
 
     struct hashtable_s *hashtable;
-    struct jscon_item_s *p_item;
-    struct jscon_composite_s *next;
-    struct jscon_composite_s *prev;
+    jscon_arena_t *arena;
 } jscon_composite_t;
 
 
-void Jscon_composite_link_r(struct jscon_item_s *item, jscon_composite_t **last_accessed_comp);
 void Jscon_composite_build(struct jscon_item_s *item);
 struct jscon_item_s* Jscon_composite_get(const char *key, struct jscon_item_s *item);
 struct jscon_item_s* Jscon_composite_set(const char *key, struct jscon_item_s *item);
-void Jscon_composite_remake(jscon_item_t *item);
-
+void Jscon_composite_unset(struct jscon_item_s *item);
+
+
+/* JSCON ITEM FLAGS
+ *  mark the resources an item doesn't own, and therefore must not be
+ *  freed or reallocated through it (ex: memory taken from an arena).
+ *  a resource that gets replaced by a heap copy has its flag cleared */
+enum jscon_flags {
+    JSCON_BORROWED_ITEM     = 1 << 0, /* the item struct itself */
+    JSCON_BORROWED_KEY      = 1 << 1,
+    JSCON_BORROWED_STRING   = 1 << 2,
+    JSCON_BORROWED_COMP     = 1 << 3, /* the jscon_composite_t struct */
+    JSCON_BORROWED_BRANCH   = 1 << 4, /* the composite's branch array */
+    /* SUPERSET FLAGS */
+    JSCON_BORROWED_ALL      = JSCON_BORROWED_ITEM | JSCON_BORROWED_KEY \
+                              | JSCON_BORROWED_STRING | JSCON_BORROWED_COMP \
+                              | JSCON_BORROWED_BRANCH,
+};
 
 /* JSCON ITEM STRUCTURE
- *  key: item's jscon key (NULL if root)
+ *  key: item's jscon key (NULL if root or array element, whose key
+ *      is its position)
  *  parent: object or array that its part of (NULL if root)
+ *  index: position at parent's branch array, may be greater than its
+ *      actual position after a removal (check jscon_composite_t)
  *  type: item's jscon datatype (check enum jscon_type_e for flags) 
+ *  flags: resources not owned by the item (check enum jscon_flags)
  *  union {string, d_number, i_number, boolean, comp}:
  *      string,d_number,i_number,boolean: item literal value, denoted 
  *      by its type.  */
@@ -131,20 +155,64 @@ typedef struct jscon_item_s {
         jscon_composite_t *comp;
     };
     enum jscon_type type;
+    unsigned flags;
 
     char *key;
     struct jscon_item_s *parent;
+    size_t index;
 } jscon_item_t;
 
 /*
  * jscon-common.c
  */
+char* Jscon_scan_string(char **p_buffer, size_t *p_len, bool *p_plain);
+size_t Jscon_utf8_length(const char *str, const char *end);
+size_t Jscon_unescape_string(char *dest, const char *src, size_t len);
 char* Jscon_decode_string(char **p_buffer);
 void Jscon_decode_static_string(char **p_buffer, const long len, const long offset, char set_str[]);
-double Jscon_decode_double(char **p_buffer);
 bool Jscon_decode_boolean(char **p_buffer);
 void Jscon_decode_null(char **p_buffer);
-jscon_composite_t* Jscon_decode_composite(char **p_buffer, size_t n_branch);
+jscon_composite_t* Jscon_decode_composite(char **p_buffer, jscon_arena_t *arena);
+
+/*
+ * jscon-arena.c
+ */
+void Jscon_arena_reset(jscon_arena_t *arena);
+void* Jscon_alloc(jscon_arena_t *arena, size_t size);
+void* Jscon_realloc(jscon_arena_t *arena, void *ptr, size_t old_size, size_t new_size);
+char* Jscon_strndup(jscon_arena_t *arena, const char *src, size_t len);
+char* Jscon_strndup_unescape(jscon_arena_t *arena, const char *src, size_t len);
+void* Jscon_arena_calloc_cb(size_t size, void *data);
+
+/*
+ * jscon-parser.c
+ */
+struct jscon_item_s* Jscon_parse_len(const char *buffer, size_t len, jscon_arena_t *arena, int flags);
+void Jscon_build_elements(struct jscon_item_s *array, const char *start, const char *end);
+
+/*
+ * jscon-intern.c
+ */
+char* Jscon_intern(const char *str, size_t len);
+
+/*
+ * jscon-validate.c
+ */
+long Jscon_validate(const char *buffer, size_t len, void (*element_cb)(const char*, void*), void *data);
+
+/*
+ * jscon-number.c
+ */
+bool Jscon_decode_number(char **p_buffer, long long *p_integer, double *p_double);
+
+/*
+ * jscon-simd.c
+ */
+char* Jscon_find_token(const char *str, char c1, char c2, char c3);
+char* Jscon_skip_blank(const char *str);
+char* Jscon_find_plain_end(const char *str);
+char* Jscon_find_escape(const char *str, const char *end);
+size_t Jscon_copy_plain(char *dest, const char *src, const char *end);
 
 
 #endif
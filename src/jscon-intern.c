@@ -0,0 +1,201 @@
+/*
+ * Copyright (c) 2020 Lucas Müller
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Key interning pool, shared by every document parsed with the
+ *  JSCON_PARSE_INTERN flag, so that identical keys share a single
+ *  immutable allocation. Lookups are lock-free: entries and tables are
+ *  published with release stores, and are never moved or freed until
+ *  jscon_intern_reset(). Insertions are serialized by a mutex, and
+ *  tables replaced on growth are kept, as a lookup might still be
+ *  probing them. Its meant for keys that repeat (a schema), so once
+ *  JSCON_INTERN_MAX_ENTRY keys are held new keys are left for each
+ *  document to own, input full of distinct keys can't grow it any
+ *  further. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include <libjscon.h>
+#include "jscon-common.h"
+#include "debug.h"
+
+#define JSCON_INTERN_MIN_CAP 256
+#define JSCON_INTERN_MAX_ENTRY 65536
+
+struct _jscon_intern_entry_s {
+    uint32_t hash;
+    size_t len;
+    char key[]; /* NUL terminated */
+};
+
+/* open addressing with linear probing, kept at most half full so that
+ *  a probe always reaches an empty slot */
+struct _jscon_intern_table_s {
+    size_t mask; /* capacity - 1, capacity being a power of two */
+    struct _jscon_intern_table_s *retired; /* table it replaced */
+    _Atomic(struct _jscon_intern_entry_s*) slot[];
+};
+
+static struct {
+    _Atomic(struct _jscon_intern_table_s*) table;
+    size_t num_entry;
+    pthread_mutex_t lock;
+} _jscon_intern = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+/* keys come from untrusted input, and the pool lives as long as the
+ *  process, so they're hashed with the seeded hash of hashtable.c
+ *  (which can't be flooded with keys computed offline) */
+static uint32_t
+_jscon_intern_hash(const char *str, size_t len){
+    return (uint32_t)hashtable_genhash(str, len);
+}
+
+static char*
+_jscon_intern_find(struct _jscon_intern_table_s *table, const char *str, size_t len, uint32_t hash)
+{
+    for (size_t i = hash & table->mask ;; i = (i + 1) & table->mask){
+        struct _jscon_intern_entry_s *entry = atomic_load_explicit(&table->slot[i], memory_order_acquire);
+        if (NULL == entry) return NULL;
+
+        if (hash == entry->hash && len == entry->len && 0 == memcmp(str, entry->key, len)){
+            return entry->key;
+        }
+    }
+}
+
+/* only called with the lock held, or before table is published */
+static void
+_jscon_intern_place(struct _jscon_intern_table_s *table, struct _jscon_intern_entry_s *entry)
+{
+    size_t i = entry->hash & table->mask;
+    while (NULL != atomic_load_explicit(&table->slot[i], memory_order_relaxed)){
+        i = (i + 1) & table->mask;
+    }
+    atomic_store_explicit(&table->slot[i], entry, memory_order_release);
+}
+
+static struct _jscon_intern_table_s*
+_jscon_intern_table_init(size_t cap, struct _jscon_intern_table_s *retired)
+{
+    struct _jscon_intern_table_s *new_table = calloc(1, sizeof *new_table + cap * sizeof(new_table->slot[0]));
+    ASSERT_S(NULL != new_table, jscon_strerror(JSCON_EXT__OUT_MEM, new_table));
+
+    new_table->mask = cap - 1;
+    new_table->retired = retired;
+
+    if (NULL != retired){ /* rehash entries before it's published */
+        for (size_t i=0; i <= retired->mask; ++i){
+            struct _jscon_intern_entry_s *entry = atomic_load_explicit(&retired->slot[i], memory_order_relaxed);
+            if (NULL != entry){
+                _jscon_intern_place(new_table, entry);
+            }
+        }
+    }
+
+    return new_table;
+}
+
+static char*
+_jscon_intern_insert(const char *str, size_t len, uint32_t hash)
+{
+    pthread_mutex_lock(&_jscon_intern.lock);
+
+    struct _jscon_intern_table_s *table = atomic_load_explicit(&_jscon_intern.table, memory_order_relaxed);
+    if (NULL == table){
+        table = _jscon_intern_table_init(JSCON_INTERN_MIN_CAP, NULL);
+        atomic_store_explicit(&_jscon_intern.table, table, memory_order_release);
+    }
+
+    /* might have been inserted since the lock-free lookup */
+    char *key = _jscon_intern_find(table, str, len, hash);
+    if (NULL != key) goto unlock;
+
+    if (_jscon_intern.num_entry >= JSCON_INTERN_MAX_ENTRY) goto unlock;
+
+    if (2 * (_jscon_intern.num_entry + 1) > table->mask + 1){
+        table = _jscon_intern_table_init(2 * (table->mask + 1), table);
+        atomic_store_explicit(&_jscon_intern.table, table, memory_order_release);
+    }
+
+    struct _jscon_intern_entry_s *new_entry = malloc(sizeof *new_entry + len + 1);
+    ASSERT_S(NULL != new_entry, jscon_strerror(JSCON_EXT__OUT_MEM, new_entry));
+
+    new_entry->hash = hash;
+    new_entry->len = len;
+    memcpy(new_entry->key, str, len);
+    new_entry->key[len] = '\0';
+
+    _jscon_intern_place(table, new_entry);
+    ++_jscon_intern.num_entry;
+
+    key = new_entry->key;
+
+unlock:
+    pthread_mutex_unlock(&_jscon_intern.lock);
+
+    return key;
+}
+
+/* return the pool's copy of the len bytes long str, which is added to
+ *  the pool if missing, or NULL if it's missing and the pool is full.
+ *  the copy is NUL terminated, and must not be modified nor freed */
+char*
+Jscon_intern(const char *str, size_t len)
+{
+    uint32_t hash = _jscon_intern_hash(str, len);
+
+    struct _jscon_intern_table_s *table = atomic_load_explicit(&_jscon_intern.table, memory_order_acquire);
+    if (NULL != table){
+        char *key = _jscon_intern_find(table, str, len, hash);
+        if (NULL != key) return key;
+    }
+
+    return _jscon_intern_insert(str, len, hash);
+}
+
+/* free every key of the pool, and the tables that held them. no
+ *  document parsed with JSCON_PARSE_INTERN may be alive, nor being
+ *  parsed, as their keys point to the pool */
+void
+jscon_intern_reset(void)
+{
+    pthread_mutex_lock(&_jscon_intern.lock);
+
+    struct _jscon_intern_table_s *table = atomic_exchange_explicit(&_jscon_intern.table, NULL, memory_order_acq_rel);
+    if (NULL != table){ /* retired tables hold a subset of its entries */
+        for (size_t i=0; i <= table->mask; ++i){
+            free(atomic_load_explicit(&table->slot[i], memory_order_relaxed));
+        }
+    }
+    while (NULL != table){
+        struct _jscon_intern_table_s *retired = table->retired;
+        free(table);
+        table = retired;
+    }
+    _jscon_intern.num_entry = 0;
+
+    pthread_mutex_unlock(&_jscon_intern.lock);
+}
@@ -0,0 +1,426 @@
+/*
+ * Copyright (c) 2020 Lucas Müller
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Multi-threaded parsing.
+ *
+ * NEWLINE DELIMITED JSON (NDJSON) BATCHES
+ * The input is split into blocks of JSCON_MANY_BLOCK_MIN up to
+ *  JSCON_MANY_BLOCK_MAX bytes, each extended up to the next newline so
+ *  that every record belongs to the block where it starts. Workers claim
+ *  blocks in order, and parse every record of a block into an arena of
+ *  its own. Once delivered to the callback, a block's records are
+ *  released along with its arena.
+ *
+ * In-order delivery is done by whichever worker completes the block
+ *  that is next in line, which also delivers the blocks completed
+ *  meanwhile. Workers don't run further than JSCON_MANY_WINDOW blocks
+ *  per thread ahead of delivery, so memory stays bounded.
+ *
+ * SINGLE TOP-LEVEL ARRAY
+ * The validation pass reports where each top-level element starts,
+ *  and the array is cut into JSCON_MANY_WINDOW ranges per thread of
+ *  about the same size. Workers build each range's elements into a
+ *  temporary array, which are then stitched in order into the root. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include <libjscon.h>
+#include "jscon-common.h"
+#include "debug.h"
+
+#define JSCON_MANY_BLOCK_MIN (64 * 1024)
+#define JSCON_MANY_BLOCK_MAX (1024 * 1024)
+#define JSCON_MANY_WINDOW 4
+
+struct _jscon_block_s {
+    jscon_arena_t *arena;
+    jscon_item_t **root;
+    size_t num_root;
+    size_t cap_root;
+    bool ready; /* parsed and waiting for delivery */
+};
+
+struct _jscon_many_s {
+    const char *buffer;
+    size_t len;
+    int flags; /* enum jscon_parse_flags */
+    jscon_many_cb *callback;
+    void *data;
+
+    struct _jscon_block_s *block;
+    size_t num_block;
+    size_t block_size;
+
+    pthread_mutex_t lock;
+    pthread_cond_t delivered; /* signaled when next_deliver moves */
+    size_t next_claim; /* next block to be parsed */
+    size_t next_deliver; /* next block to be delivered, if ordered */
+    size_t max_ahead; /* how many blocks can be claimed past next_deliver */
+    bool delivering; /* a worker is delivering blocks */
+};
+
+/* start of block i, the position after the first newline at or after
+    its nominal offset */
+static const char*
+_jscon_block_start(struct _jscon_many_s *many, size_t i)
+{
+    if (0 == i) return many->buffer;
+
+    size_t offset = i * many->block_size;
+    if (offset >= many->len) return many->buffer + many->len;
+
+    const char *newline = memchr(many->buffer + offset, '\n', many->len - offset);
+    return (NULL != newline) ? newline + 1 : many->buffer + many->len;
+}
+
+static void
+_jscon_block_parse(struct _jscon_many_s *many, struct _jscon_block_s *block, size_t i)
+{
+    const char *record = _jscon_block_start(many, i);
+    const char *end = _jscon_block_start(many, i + 1);
+
+    block->arena = jscon_arena_init();
+
+    while (record < end){
+        const char *newline = memchr(record, '\n', end - record);
+        const char *record_end = (NULL != newline) ? newline : end;
+
+        /* skip empty lines */
+        const char *tmp = record;
+        while (tmp < record_end && IS_BLANK_CHAR(*tmp)){
+            ++tmp;
+        }
+
+        if (tmp < record_end){
+            if (block->num_root == block->cap_root){
+                block->cap_root = (0 == block->cap_root) ? 64 : 2 * block->cap_root;
+                block->root = realloc(block->root, block->cap_root * sizeof(jscon_item_t*));
+                ASSERT_S(NULL != block->root, jscon_strerror(JSCON_EXT__OUT_MEM, block->root));
+            }
+            block->root[block->num_root++] = Jscon_parse_len(record, record_end - record, block->arena, many->flags & JSCON_PARSE_INTERN);
+        }
+
+        record = record_end + 1;
+    }
+}
+
+static void
+_jscon_block_deliver(struct _jscon_many_s *many, struct _jscon_block_s *block)
+{
+    for (size_t i=0; i < block->num_root; ++i){
+        (*many->callback)(block->root[i], many->data);
+    }
+
+    jscon_arena_destroy(block->arena);
+    block->arena = NULL;
+
+    free(block->root);
+    block->root = NULL;
+    block->num_root = block->cap_root = 0;
+}
+
+/* deliver every consecutive block that is ready, starting at
+    next_deliver, lock must be held */
+static void
+_jscon_many_deliver_ready(struct _jscon_many_s *many)
+{
+    if (many->delivering) return; /* another worker is on it */
+
+    many->delivering = true;
+    while (many->next_deliver < many->num_block && many->block[many->next_deliver].ready){
+        struct _jscon_block_s *block = &many->block[many->next_deliver];
+
+        pthread_mutex_unlock(&many->lock);
+        _jscon_block_deliver(many, block);
+        pthread_mutex_lock(&many->lock);
+
+        ++many->next_deliver;
+        pthread_cond_broadcast(&many->delivered);
+    }
+    many->delivering = false;
+}
+
+static void*
+_jscon_many_worker(void *p_many)
+{
+    struct _jscon_many_s *many = p_many;
+    bool is_ordered = !(many->flags & JSCON_PARSE_UNORDERED);
+
+    pthread_mutex_lock(&many->lock);
+    while (many->next_claim < many->num_block){
+        size_t i = many->next_claim++;
+
+        /* don't get too far ahead of delivery */
+        while (is_ordered && i >= many->next_deliver + many->max_ahead){
+            pthread_cond_wait(&many->delivered, &many->lock);
+        }
+        pthread_mutex_unlock(&many->lock);
+
+        struct _jscon_block_s *block = &many->block[i];
+        _jscon_block_parse(many, block, i);
+
+        if (!is_ordered){
+            _jscon_block_deliver(many, block);
+            pthread_mutex_lock(&many->lock);
+            continue;
+        }
+
+        pthread_mutex_lock(&many->lock);
+        block->ready = true;
+        _jscon_many_deliver_ready(many);
+    }
+    pthread_mutex_unlock(&many->lock);
+
+    return NULL;
+}
+
+/* parse every newline delimited record of buffer on nthreads threads
+    (or one per core if nthreads < 1), and hand each root to callback.
+    roots are delivered in input order, unless JSCON_PARSE_UNORDERED is
+    given, in which case callback may be called concurrently */
+void
+jscon_parse_many(const char *buffer, size_t len, int nthreads, int flags, jscon_many_cb *callback, void *data)
+{
+    ASSERT_S(NULL != buffer, "Missing JSON text buffer");
+    ASSERT_S(NULL != callback, "Missing callback");
+
+    if (nthreads < 1){
+        long num_cpu = sysconf(_SC_NPROCESSORS_ONLN);
+        nthreads = (num_cpu > 0) ? (int)num_cpu : 1;
+    }
+
+    struct _jscon_many_s many = {
+        .buffer = buffer,
+        .len = len,
+        .flags = flags,
+        .callback = callback,
+        .data = data,
+        .max_ahead = JSCON_MANY_WINDOW * (size_t)nthreads,
+    };
+
+    /* enough blocks for every thread to be kept busy */
+    many.block_size = len / (8 * (size_t)nthreads);
+    if (many.block_size < JSCON_MANY_BLOCK_MIN)
+        many.block_size = JSCON_MANY_BLOCK_MIN;
+    else if (many.block_size > JSCON_MANY_BLOCK_MAX)
+        many.block_size = JSCON_MANY_BLOCK_MAX;
+
+    many.num_block = (len + many.block_size - 1) / many.block_size;
+    if (0 == many.num_block) return;
+
+    many.block = calloc(many.num_block, sizeof *many.block);
+    ASSERT_S(NULL != many.block, jscon_strerror(JSCON_EXT__OUT_MEM, many.block));
+
+    pthread_mutex_init(&many.lock, NULL);
+    pthread_cond_init(&many.delivered, NULL);
+
+    /* the calling thread works as well */
+    if ((size_t)nthreads > many.num_block){
+        nthreads = (int)many.num_block;
+    }
+    pthread_t *thread = calloc(nthreads, sizeof *thread);
+    ASSERT_S(NULL != thread, jscon_strerror(JSCON_EXT__OUT_MEM, thread));
+
+    for (int i=0; i < nthreads - 1; ++i){
+        int ret = pthread_create(&thread[i], NULL, &_jscon_many_worker, &many);
+        ASSERT_S(0 == ret, "Couldn't create worker thread");
+    }
+    _jscon_many_worker(&many);
+    for (int i=0; i < nthreads - 1; ++i){
+        pthread_join(thread[i], NULL);
+    }
+
+    pthread_cond_destroy(&many.delivered);
+    pthread_mutex_destroy(&many.lock);
+    free(thread);
+    free(many.block);
+}
+
+struct _jscon_range_s {
+    const char *start; /* first char of the range's first element */
+    jscon_item_t *array; /* temporary array holding its elements */
+};
+
+struct _jscon_parallel_s {
+    const char *buffer;
+    size_t len;
+    const char *close; /* root array's ']' */
+
+    struct _jscon_range_s *range;
+    size_t num_range;
+    size_t cap_range;
+
+    pthread_mutex_t lock;
+    size_t next_claim; /* next range to be built */
+};
+
+/* validation callback, keep the first element found past each cut */
+static void
+_jscon_parallel_cut(const char *element, void *p_parallel)
+{
+    struct _jscon_parallel_s *parallel = p_parallel;
+
+    size_t offset = element - parallel->buffer;
+    size_t cut = parallel->num_range * (parallel->len / parallel->cap_range);
+    if (parallel->num_range == parallel->cap_range || offset < cut) return;
+
+    parallel->range[parallel->num_range++].start = element;
+}
+
+/* end of range i, the ',' or ']' that follows its last element */
+static const char*
+_jscon_range_end(struct _jscon_parallel_s *parallel, size_t i)
+{
+    if (i + 1 == parallel->num_range) return parallel->close;
+
+    const char *end = parallel->range[i+1].start - 1;
+    while (',' != *end){
+        --end; /* skip blank chars in between */
+    }
+    return end;
+}
+
+static void*
+_jscon_parallel_worker(void *p_parallel)
+{
+    struct _jscon_parallel_s *parallel = p_parallel;
+
+    pthread_mutex_lock(&parallel->lock);
+    while (parallel->next_claim < parallel->num_range){
+        size_t i = parallel->next_claim++;
+        pthread_mutex_unlock(&parallel->lock);
+
+        struct _jscon_range_s *range = &parallel->range[i];
+
+        range->array = Jscon_alloc(NULL, sizeof(jscon_item_t));
+        range->array->type = JSCON_ARRAY;
+        range->array->comp = Jscon_alloc(NULL, sizeof(jscon_composite_t));
+
+        Jscon_build_elements(range->array, range->start, _jscon_range_end(parallel, i));
+
+        pthread_mutex_lock(&parallel->lock);
+    }
+    pthread_mutex_unlock(&parallel->lock);
+
+    return NULL;
+}
+
+/* move every range's elements into root, in order */
+static void
+_jscon_parallel_stitch(struct _jscon_parallel_s *parallel, jscon_item_t *root)
+{
+    size_t num_branch = 0;
+    for (size_t i=0; i < parallel->num_range; ++i){
+        num_branch += parallel->range[i].array->comp->num_branch;
+    }
+
+    root->comp->branch = malloc(num_branch * sizeof(jscon_item_t*));
+    ASSERT_S(NULL != root->comp->branch, jscon_strerror(JSCON_EXT__OUT_MEM, root->comp->branch));
+    root->comp->cap_branch = num_branch;
+
+    for (size_t i=0; i < parallel->num_range; ++i){
+        jscon_item_t *array = parallel->range[i].array;
+
+        for (size_t j=0; j < array->comp->num_branch; ++j){
+            array->comp->branch[j]->parent = root;
+            array->comp->branch[j]->index = root->comp->num_branch;
+            root->comp->branch[root->comp->num_branch++] = array->comp->branch[j];
+        }
+
+        free(array->comp->branch);
+        free(array->comp);
+        free(array);
+    }
+}
+
+/* parse buffer on nthreads threads (or one per core if nthreads < 1),
+    if its root is an array its elements are built concurrently */
+jscon_item_t*
+jscon_parse_parallel(const char *buffer, size_t len, int nthreads)
+{
+    ASSERT_S(NULL != buffer, "Missing JSON text buffer");
+
+    if (nthreads < 1){
+        long num_cpu = sysconf(_SC_NPROCESSORS_ONLN);
+        nthreads = (num_cpu > 0) ? (int)num_cpu : 1;
+    }
+
+    struct _jscon_parallel_s parallel = {
+        .buffer = buffer,
+        .len = len,
+        .cap_range = JSCON_MANY_WINDOW * (size_t)nthreads,
+    };
+    parallel.range = calloc(parallel.cap_range, sizeof *parallel.range);
+    ASSERT_S(NULL != parallel.range, jscon_strerror(JSCON_EXT__OUT_MEM, parallel.range));
+
+    long err_offset = Jscon_validate(buffer, len, &_jscon_parallel_cut, &parallel);
+    if (-1 != err_offset){
+        ERROR("Invalid JSON text at offset %ld", err_offset);
+    }
+
+    /* not worth splitting */
+    if (1 == nthreads || parallel.num_range < 2){
+        free(parallel.range);
+        return Jscon_parse_len(buffer, len, NULL, JSCON_PARSE_DEFAULT);
+    }
+
+    /* root array, its elements are built by the workers */
+    char *open = Jscon_skip_blank(buffer); /* validated, '[' follows */
+    jscon_item_t *root = Jscon_alloc(NULL, sizeof(jscon_item_t));
+    root->type = JSCON_ARRAY;
+    root->comp = Jscon_decode_composite(&open, NULL);
+
+    parallel.close = buffer + len - 1;
+    while (']' != *parallel.close){
+        --parallel.close; /* skip trailing blank chars */
+    }
+
+    pthread_mutex_init(&parallel.lock, NULL);
+
+    /* the calling thread works as well */
+    if ((size_t)nthreads > parallel.num_range){
+        nthreads = (int)parallel.num_range;
+    }
+    pthread_t *thread = calloc(nthreads, sizeof *thread);
+    ASSERT_S(NULL != thread, jscon_strerror(JSCON_EXT__OUT_MEM, thread));
+
+    for (int i=0; i < nthreads - 1; ++i){
+        int ret = pthread_create(&thread[i], NULL, &_jscon_parallel_worker, &parallel);
+        ASSERT_S(0 == ret, "Couldn't create worker thread");
+    }
+    _jscon_parallel_worker(&parallel);
+    for (int i=0; i < nthreads - 1; ++i){
+        pthread_join(thread[i], NULL);
+    }
+
+    _jscon_parallel_stitch(&parallel, root);
+
+    pthread_mutex_destroy(&parallel.lock);
+    free(thread);
+    free(parallel.range);
+
+    return root;
+}
@@ -0,0 +1,349 @@
+/*
+ * Copyright (c) 2020 Lucas Müller
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Number decoding, exact and independent of the current locale.
+ *
+ * Integers that fit a long long are converted directly, without going
+ *  through a double. Other numbers have their significand and exponent
+ *  extracted once, and are then converted by the first applicable path:
+ *
+ *  1. Clinger's fast path: significand and 10^exp are both exactly
+ *      representable, a single IEEE multiplication or division is
+ *      correctly rounded.
+ *  2. Eisel-Lemire: multiply the significand by a 128-bit approximation
+ *      of 5^exp and round, bailing out when the result is ambiguous.
+ *  3. strtod() under the "C" locale, for whatever is left. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <float.h>
+#include <limits.h>
+#include <locale.h>
+#include <stdatomic.h>
+
+#include <libjscon.h>
+#include "jscon-common.h"
+#include "debug.h"
+
+#if defined(__SIZEOF_INT128__)
+#  define JSCON_HAS_INT128 1
+#  include "jscon-pow5.h"
+__extension__ typedef unsigned __int128 jscon_uint128_t;
+#else
+#  define JSCON_HAS_INT128 0
+#endif
+
+#define IS_DIGIT(c) ((unsigned)((unsigned char)(c) - '0') < 10u)
+
+/* maximum amount of significant digits that always fit an uint64_t */
+#define MAX_SIGNIFICANT_DIG 19
+
+static const uint64_t _jscon_pow10_u64[MAX_SIGNIFICANT_DIG+1] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL,
+    10000000ULL, 100000000ULL, 1000000000ULL, 10000000000ULL,
+    100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+    100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+    100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL
+};
+
+static const double _jscon_pow10_f64[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/* convert 8 ascii digits at once (SWAR), str must hold 8 digits */
+static inline uint64_t
+_jscon_parse_8digits(const char *str)
+{
+    uint64_t val;
+    memcpy(&val, str, sizeof(val));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    val = __builtin_bswap64(val);
+#endif
+    val -= 0x3030303030303030ULL;
+    val = (val * 10) + (val >> 8); /* pairs of digits */
+    val = (((val & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32)))
+           + (((val >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32)))) >> 32;
+    return val;
+}
+
+/* convert len digits (at most MAX_SIGNIFICANT_DIG) to an integer */
+static uint64_t
+_jscon_parse_digits(const char *str, size_t len)
+{
+    uint64_t val = 0;
+    while (len >= 8){
+        val = val * 100000000ULL + _jscon_parse_8digits(str);
+        str += 8;
+        len -= 8;
+    }
+    while (len--){
+        val = val * 10 + (uint64_t)(*str++ - '0');
+    }
+    return val;
+}
+
+#if JSCON_HAS_INT128
+/* Eisel-Lemire algorithm, computes w * 10^q correctly rounded to
+ *  nearest, returns false if it can't decide the rounding */
+static bool
+_jscon_eisel_lemire(uint64_t w, long long q, bool negative, double *p_double)
+{
+    uint64_t bits;
+
+    if (0 == w || q < JSCON_POW5_MIN){
+        bits = 0;
+        goto done;
+    }
+    if (q > JSCON_POW5_MAX){
+        bits = 0x7FFULL << 52; /* infinity */
+        goto done;
+    }
+
+    int lz = __builtin_clzll(w);
+    w <<= lz;
+
+    /* 128-bit product, only computes the lower half when the
+     *  55 most significant bits might depend on it */
+    const uint64_t *pow5 = &jscon_pow5_128[2*(q-JSCON_POW5_MIN)];
+    jscon_uint128_t product = (jscon_uint128_t)w * pow5[0];
+    uint64_t upper = (uint64_t)(product >> 64);
+    uint64_t lower = (uint64_t)product;
+    if (0x1FF == (upper & 0x1FF)){
+        jscon_uint128_t second = (jscon_uint128_t)w * pow5[1];
+        uint64_t second_high = (uint64_t)(second >> 64);
+        lower += second_high;
+        if (second_high > lower) ++upper;
+        if (0xFFFFFFFFFFFFFFFFULL == lower && (q < -27 || q > 55)){
+            return false; /* can't tell if truncation affects rounding */
+        }
+    }
+
+    int upperbit = (int)(upper >> 63);
+    uint64_t mantissa = upper >> (upperbit + 9);
+    /* floor(q * log2(10)) + 63, minus the smallest double exponent */
+    long long power2 = ((217706 * q) >> 16) + 63 + upperbit - lz + 1023;
+
+    if (power2 <= 0){ /* subnormal */
+        if (-power2 + 1 >= 64){
+            bits = 0;
+            goto done;
+        }
+        mantissa >>= -power2 + 1;
+        mantissa += (mantissa & 1);
+        mantissa >>= 1;
+        power2 = (mantissa < (1ULL << 52)) ? 0 : 1;
+        bits = (mantissa & ~(1ULL << 52)) | ((uint64_t)power2 << 52);
+        goto done;
+    }
+
+    /* exactly halfway between two doubles, round to even */
+    if (lower <= 1 && q >= -4 && q <= 23 && 1 == (mantissa & 3)
+        && (mantissa << (upperbit + 9)) == upper)
+    {
+        mantissa &= ~1ULL;
+    }
+
+    mantissa += (mantissa & 1);
+    mantissa >>= 1;
+    if (mantissa >= (2ULL << 52)){
+        mantissa = (1ULL << 52);
+        ++power2;
+    }
+    mantissa &= ~(1ULL << 52);
+
+    if (power2 >= 0x7FF){
+        bits = 0x7FFULL << 52; /* infinity */
+    } else {
+        bits = mantissa | ((uint64_t)power2 << 52);
+    }
+
+done:
+    if (negative) bits |= 1ULL << 63;
+    memcpy(p_double, &bits, sizeof(bits));
+    return true;
+}
+#endif
+
+/* slow path, strtod() is made to ignore the user's locale */
+static double
+_jscon_strtod_c(const char *start)
+{
+    /* created once, by whichever thread gets there first */
+    static _Atomic(locale_t) c_locale;
+    locale_t locale = atomic_load_explicit(&c_locale, memory_order_acquire);
+    if (!locale){
+        locale_t tmp = newlocale(LC_NUMERIC_MASK, "C", (locale_t)0);
+        ASSERT_S(tmp, jscon_strerror(JSCON_EXT__OUT_MEM, tmp));
+        if (atomic_compare_exchange_strong_explicit(&c_locale, &locale, tmp,
+                                                    memory_order_acq_rel, memory_order_acquire))
+        {
+            locale = tmp;
+        } else {
+            freelocale(tmp); /* another thread got there first */
+        }
+    }
+
+    locale_t old_locale = uselocale(locale);
+    double set_double = strtod(start, NULL);
+    uselocale(old_locale);
+
+    return set_double;
+}
+
+/* decode the number at *p_buffer, returns true and assigns p_integer
+ *  if it is a integer that fits a long long, otherwise returns false
+ *  and assigns p_double */
+bool
+Jscon_decode_number(char **p_buffer, long long *p_integer, double *p_double)
+{
+    char *start = *p_buffer;
+    char *end = start;
+
+    /* 1st STEP: check for a minus sign and skip it */
+    bool negative = ('-' == *end);
+    if (negative){
+        ++end; /* skips minus sign */
+    }
+
+    /* 2nd STEP: skips until a non digit char found */
+    ASSERT_S(IS_DIGIT(*end), jscon_strerror(JSCON_EXT__INVALID_NUMBER, end)); /* interrupt if char isn't digit */
+    char *int_start = end;
+    while (IS_DIGIT(*++end))
+        continue; /* skips while char is digit */
+    char *int_end = end;
+
+    /* 3rd STEP: if non-digit char is not a comma then it must be
+        an integer*/
+    char *frac_start = end, *frac_end = end;
+    if ('.' == *end){
+        frac_start = end + 1;
+        while (IS_DIGIT(*++end))
+            continue;
+        frac_end = end;
+    }
+
+    /* 4th STEP: if exponent found decode it, saturating on overflow
+        as anything this big is either zero or infinity */
+    long long exp10 = 0;
+    bool has_exp = false;
+    if (('e' == *end) || ('E' == *end)){
+        has_exp = true;
+        ++end;
+        bool exp_negative = ('-' == *end);
+        if (('+' == *end) || ('-' == *end)){ 
+            ++end;
+        }
+        ASSERT_S(IS_DIGIT(*end), jscon_strerror(JSCON_EXT__INVALID_NUMBER, end)); /* interrupt if char isn't digit */
+        do {
+            if (exp10 < 100000) exp10 = exp10 * 10 + (*end - '0');
+        } while (IS_DIGIT(*++end));
+        if (exp_negative) exp10 = -exp10;
+    }
+
+    *p_buffer = end; /* skips entire length of number */
+
+    /* 5th STEP: integer fast path, no double conversion involved */
+    size_t num_int = int_end - int_start;
+    if (frac_start == frac_end && !has_exp && num_int <= MAX_SIGNIFICANT_DIG){
+        uint64_t w = _jscon_parse_digits(int_start, num_int);
+        if (!negative && w <= (uint64_t)LLONG_MAX){
+            *p_integer = (long long)w;
+            return true;
+        }
+        if (negative && w <= (uint64_t)LLONG_MAX + 1){
+            *p_integer = (w == (uint64_t)LLONG_MAX + 1) ? LLONG_MIN : -(long long)w;
+            return true;
+        }
+    }
+
+    /* 6th STEP: extract significand w and exponent q, so that the
+        number is w * 10^q, truncating it to its significant digits */
+    while (int_start < int_end && '0' == *int_start){
+        ++int_start; /* skip leading zeroes */
+    }
+    num_int = int_end - int_start;
+    if (0 == num_int){
+        while (frac_start < frac_end && '0' == *frac_start){
+            ++frac_start; /* skip leading zeroes after decimal point */
+            --exp10;
+        }
+    }
+    size_t num_frac = frac_end - frac_start;
+
+    uint64_t w;
+    long long q;
+    bool truncated = false;
+    if (num_int + num_frac <= MAX_SIGNIFICANT_DIG){
+        w = _jscon_parse_digits(int_start, num_int) * _jscon_pow10_u64[num_frac]
+            + _jscon_parse_digits(frac_start, num_frac);
+        q = exp10 - (long long)num_frac;
+    } else if (num_int >= MAX_SIGNIFICANT_DIG){
+        w = _jscon_parse_digits(int_start, MAX_SIGNIFICANT_DIG);
+        q = exp10 + (long long)(num_int - MAX_SIGNIFICANT_DIG);
+        truncated = true;
+    } else {
+        size_t num_taken = MAX_SIGNIFICANT_DIG - num_int;
+        w = _jscon_parse_digits(int_start, num_int) * _jscon_pow10_u64[num_taken]
+            + _jscon_parse_digits(frac_start, num_taken);
+        q = exp10 - (long long)num_taken;
+        truncated = true;
+    }
+
+    /* 7th STEP: convert w * 10^q to double */
+    double set_double;
+#if FLT_EVAL_METHOD == 0
+    if (!truncated && w <= (1ULL << 53) && q >= -22 && q <= 22){
+        set_double = (double)w;
+        if (q < 0)
+            set_double /= _jscon_pow10_f64[-q];
+        else
+            set_double *= _jscon_pow10_f64[q];
+        if (negative) set_double = -set_double;
+        goto classify;
+    }
+#endif
+#if JSCON_HAS_INT128
+    if (_jscon_eisel_lemire(w, q, negative, &set_double)){
+        double upper_double;
+        /* a truncated significand lies between w and w+1, the result
+            is exact only if both round to the same double */
+        if (!truncated
+            || (_jscon_eisel_lemire(w+1, q, negative, &upper_double)
+                && upper_double == set_double))
+        {
+            goto classify;
+        }
+    }
+#endif
+    set_double = _jscon_strtod_c(start);
+
+classify:
+    if (DOUBLE_IS_INTEGER(set_double)){
+        *p_integer = (long long)set_double;
+        return true;
+    }
+    *p_double = set_double;
+    return false;
+}
@@ -24,7 +24,13 @@
 #include <stdlib.h>
 #include <stdarg.h>
 #include <string.h>
+#include <stdatomic.h>
 #include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include <libjscon.h>
 
@@ -34,9 +40,13 @@
 
 struct _jscon_utils_s {
     char *buffer;
+    jscon_arena_t *arena; /* allocate from arena, heap if NULL */
+    int flags; /* enum jscon_parse_flags */
     char *key; /* holds key ptr to be received by item */
-    jscon_composite_t *last_accessed_comp; /* holds last composite accessed */
+    bool key_borrowed; /* key points to the buffer or to the intern pool */
     jscon_cb *parse_cb; /* parser callback */
+    size_t skip_depth; /* nesting left of a pruned composite being skipped */
+    char skip_ldelim, skip_rdelim; /* the pruned composite's delimiters */
 };
 
 /* function pointers used while building json items, 
@@ -46,10 +56,14 @@ typedef void (jscon_create_value)(jscon_item_t *item, struct _jscon_utils_s *uti
 typedef jscon_item_t* (jscon_create_item)(jscon_item_t*, struct _jscon_utils_s*, jscon_create_value*);
 
 static jscon_item_t*
-_jscon_item_init()
+_jscon_item_init(struct _jscon_utils_s *utils)
 {
-    jscon_item_t *new_item = calloc(1, sizeof *new_item);
-    ASSERT_S(NULL != new_item, jscon_strerror(JSCON_EXT__OUT_MEM, new_item));
+    jscon_item_t *new_item = Jscon_alloc(utils->arena, sizeof *new_item);
+
+    /* resources taken from the arena are released alongside it */
+    if (NULL != utils->arena){
+        new_item->flags = JSCON_BORROWED_ALL;
+    }
 
     return new_item;
 }
@@ -57,13 +71,25 @@ _jscon_item_init()
 /* create a new branch to current jscon object item, and return
     the new branch address */
 static jscon_item_t*
-_jscon_branch_init(jscon_item_t *item)
+_jscon_branch_init(jscon_item_t *item, struct _jscon_utils_s *utils)
 {
+    /* branches are found one at a time, grow the branch array
+        geometrically so that the buffer is traversed only once */
+    if (item->comp->num_branch == item->comp->cap_branch){
+        size_t new_cap = (0 == item->comp->cap_branch) ? 4 : 2 * item->comp->cap_branch;
+
+        item->comp->branch = Jscon_realloc(utils->arena, item->comp->branch,
+                                           item->comp->cap_branch * sizeof(jscon_item_t*),
+                                           new_cap * sizeof(jscon_item_t*));
+        item->comp->cap_branch = new_cap;
+    }
+
     ++item->comp->num_branch;
 
-    item->comp->branch[item->comp->num_branch-1] = _jscon_item_init();
+    item->comp->branch[item->comp->num_branch-1] = _jscon_item_init(utils);
 
     item->comp->branch[item->comp->num_branch-1]->parent = item;
+    item->comp->branch[item->comp->num_branch-1]->index = item->comp->num_branch-1;
 
     return item->comp->branch[item->comp->num_branch-1];
 }
@@ -71,12 +97,18 @@ _jscon_branch_init(jscon_item_t *item)
 static void
 _jscon_composite_destroy(jscon_item_t *item)
 {
-    hashtable_destroy(item->comp->hashtable);
+    if (NULL != item->comp->hashtable){
+        hashtable_destroy(item->comp->hashtable);
+    }
 
-    free(item->comp->branch);
+    if (!(item->flags & JSCON_BORROWED_BRANCH)){
+        free(item->comp->branch);
+    }
     item->comp->branch = NULL;
 
-    free(item->comp);
+    if (!(item->flags & JSCON_BORROWED_COMP)){
+        free(item->comp);
+    }
     item->comp = NULL;
 }
 
@@ -92,7 +124,9 @@ _jscon_destroy_preorder(jscon_item_t *item)
         _jscon_composite_destroy(item);
         break;
     case JSCON_STRING:
-        free(item->string);
+        if (!(item->flags & JSCON_BORROWED_STRING)){
+            free(item->string);
+        }
         item->string = NULL;
         break;
     default:
@@ -100,26 +134,100 @@ _jscon_destroy_preorder(jscon_item_t *item)
     }
 
     if (NULL != item->key){
-        free(item->key);
+        if (!(item->flags & JSCON_BORROWED_KEY)){
+            free(item->key);
+        }
         item->key = NULL;
     }
 
-    free(item);
+    if (!(item->flags & JSCON_BORROWED_ITEM)){
+        free(item);
+    }
     item = NULL;
 }
 
-/* destroy current item and all of its nested object/arrays */
+/* destroy current item and all of its nested object/arrays, resources
+    borrowed from an arena are left to be released alongside it */
 void
 jscon_destroy(jscon_item_t *item){
     _jscon_destroy_preorder(jscon_get_root(item));
 }
 
+/* decode string at current buffer position, in-situ strings are
+    decoded in place (and NUL terminated at most over its closing
+    double quotes) instead of being copied */
+static char*
+_jscon_decode_string(struct _jscon_utils_s *utils)
+{
+    size_t len;
+    bool plain;
+    char *start = Jscon_scan_string(&utils->buffer, &len, &plain);
+
+    if (utils->flags & JSCON_PARSE_INSITU){
+        if (plain)
+            start[len] = '\0';
+        else
+            Jscon_unescape_string(start, start, len);
+        return start;
+    }
+
+    if (plain){
+        return Jscon_strndup(utils->arena, start, len);
+    }
+    return Jscon_strndup_unescape(utils->arena, start, len);
+}
+
+/* decode key at current buffer position, interned keys are shared
+    with every other document parsed alike (check jscon-intern.c),
+    unless the pool is full and the key is new to it */
+static char*
+_jscon_decode_key(struct _jscon_utils_s *utils)
+{
+    if (!(utils->flags & JSCON_PARSE_INTERN)){
+        utils->key_borrowed = (utils->flags & JSCON_PARSE_INSITU);
+        return _jscon_decode_string(utils);
+    }
+
+    size_t len;
+    bool plain;
+    char *start = Jscon_scan_string(&utils->buffer, &len, &plain);
+
+    /* plain keys are looked up straight from the buffer */
+    char tmp[256], *decoded = NULL;
+    if (!plain){
+        if (len < sizeof(tmp)){
+            decoded = tmp;
+            len = Jscon_unescape_string(tmp, start, len);
+        } else {
+            decoded = Jscon_strndup_unescape(NULL, start, len);
+            len = strlen(decoded);
+        }
+        start = decoded;
+    }
+
+    char *key = Jscon_intern(start, len);
+    utils->key_borrowed = (NULL != key);
+    if (NULL == key){ /* owned by this document instead */
+        key = Jscon_strndup(utils->arena, start, len);
+    }
+
+    if (tmp != decoded){
+        free(decoded);
+    }
+
+    return key;
+}
+
 /* fetch string type jscon and return allocated string */
 static void
 _jscon_value_set_string(jscon_item_t *item, struct _jscon_utils_s *utils)
 {
     item->type = JSCON_STRING;
-    item->string = Jscon_decode_string(&utils->buffer);
+    item->string = _jscon_decode_string(utils);
+
+    if (utils->flags & JSCON_PARSE_INSITU){
+        item->flags |= JSCON_BORROWED_STRING;
+    }
 }
 
 /* fetch number jscon type by parsing string,
@@ -127,13 +235,10 @@ _jscon_value_set_string(jscon_item_t *item, struct _jscon_utils_s *utils)
 static void
 _jscon_value_set_number(jscon_item_t *item, struct _jscon_utils_s *utils)
 {
-    double set_double = Jscon_decode_double(&utils->buffer);
-    if (DOUBLE_IS_INTEGER(set_double)){
+    if (Jscon_decode_number(&utils->buffer, &item->i_number, &item->d_number)){
         item->type = JSCON_INTEGER;
-        item->i_number = (long long)set_double;
     } else {
         item->type = JSCON_DOUBLE;
-        item->d_number = set_double;
     }
 }
 
@@ -151,120 +256,103 @@ _jscon_value_set_null(jscon_item_t *item, struct _jscon_utils_s *utils)
     Jscon_decode_null(&utils->buffer);
 }
 
-inline static size_t
-_jscon_count_property(char *buffer)
+static void
+_jscon_value_set_object(jscon_item_t *item, struct _jscon_utils_s *utils)
 {
-    /* skips the item and all of its nests, special care is taken for any
-        inner string is found, as it might contain a delim character that
-        if not treated as a string will incorrectly trigger 
-        depth action*/
-    size_t depth = 0;
-    size_t num_branch = 0;
-    do {
-        switch (*buffer){
-        case ':':
-            num_branch += (depth == 1);
-            break;
-        case '{':
-            ++depth;
-            break;
-        case '}':
-            --depth;
-            break;
-        case '\"':
-            /* loops until null terminator or end of string are found */
-            do {
-            /* skips escaped characters */
-                if ('\\' == *buffer++){
-                    ++buffer;
-                }
-            } while ('\0' != *buffer && '\"' != *buffer);
-            ASSERT_S('\"' == *buffer, jscon_strerror(JSCON_EXT__INVALID_STRING, buffer));
-            break;
-        }
-
-        ++buffer; /* skips whatever char */
+    item->type = JSCON_OBJECT;
 
-        if (0 == depth) return num_branch; /* entire item has been skipped, return */
+    item->comp = Jscon_decode_composite(&utils->buffer, utils->arena);
+}
 
-    } while ('\0' != *buffer);
+static void
+_jscon_value_set_array(jscon_item_t *item, struct _jscon_utils_s *utils)
+{
+    item->type = JSCON_ARRAY;
 
-    ERROR("Bad formatting");
-    abort();
+    item->comp = Jscon_decode_composite(&utils->buffer, utils->arena);
 }
 
+/* hand over the last decoded key to the new branch, in-situ object
+      keys point to the buffer, and interned ones to the pool */
 static void
-_jscon_value_set_object(jscon_item_t *item, struct _jscon_utils_s *utils)
+_jscon_set_key(jscon_item_t *item, struct _jscon_utils_s *utils)
 {
-    item->type = JSCON_OBJECT;
+    item->key = utils->key;
+    utils->key = NULL;
 
-    item->comp = Jscon_decode_composite(&utils->buffer, _jscon_count_property(utils->buffer));
-    Jscon_composite_link_r(item, &utils->last_accessed_comp);
+    if (utils->key_borrowed && IS_PROPERTY(item)){
+        item->flags |= JSCON_BORROWED_KEY;
+    }
 }
 
-inline static size_t
-_jscon_count_element(char *buffer)
+/* step over the pruned composite, without building anything, until
+      its matching wrapper is found. strings are jumped over as they
+      might contain a delimiter. nesting left is kept in case the end
+      of buffer is reached first (check jscon_parser_feed()) */
+static void
+_jscon_skip_composite(struct _jscon_utils_s *utils)
 {
-    /* skips the item and all of its nests, special care is taken for any
-        inner string is found, as it might contain a delim character that
-        if not treated as a string will incorrectly trigger 
-        depth action*/
-    size_t depth = 0;
-    size_t num_branch = 0;
     do {
-        switch (*buffer){
-        case ',':
-            num_branch += (depth == 1);
-            break;
-        case '[':
-            ++depth;
-            break;
-        case ']':
-            --depth;
-            break;
-        case '\"':
-        /* loops until null terminator or end of string are found */
-            do {
-                /* skips escaped characters */
-                if ('\\' == *buffer++){
-                    ++buffer;
-                }
-            } while ('\0' != *buffer && '\"' != *buffer);
-            ASSERT_S('\"' == *buffer, jscon_strerror(JSCON_EXT__INVALID_STRING, buffer));
-            break;
+        /* jumps straight to the next token that impacts depth */
+        utils->buffer = Jscon_find_token(utils->buffer, '\"', utils->skip_ldelim, utils->skip_rdelim);
+        if ('\"' == *utils->buffer){ /* treat string separately */
+            size_t len;
+            Jscon_scan_string(&utils->buffer, &len, NULL);
+            continue;
         }
+        if ('\0' == *utils->buffer) return;
 
-        ++buffer; /* skips whatever char */
-
-        if (0 == depth) return num_branch; /* entire item has been skipped, return */
+        if (utils->skip_ldelim == *utils->buffer)
+            ++utils->skip_depth;
+        else
+            --utils->skip_depth;
 
-    } while ('\0' != *buffer);
-
-    ERROR("Bad formatting");
-    abort();
+        ++utils->buffer; /* skips token */
+    } while (0 != utils->skip_depth);
 }
 
+/* the parser callback returned NULL for item's last branch, which is
+      released. if its a composite, then its branches are skipped
+      instead of built */
 static void
-_jscon_value_set_array(jscon_item_t *item, struct _jscon_utils_s *utils)
+_jscon_branch_prune(jscon_item_t *item, struct _jscon_utils_s *utils)
 {
-    item->type = JSCON_ARRAY;
+    jscon_item_t *branch = item->comp->branch[--item->comp->num_branch];
+
+    if (IS_COMPOSITE(branch)){
+        utils->skip_depth = 1; /* opening delimiter has been consumed */
+        if (JSCON_OBJECT == branch->type){
+            utils->skip_ldelim = '{';
+            utils->skip_rdelim = '}';
+        } else {
+            utils->skip_ldelim = '[';
+            utils->skip_rdelim = ']';
+        }
+        _jscon_skip_composite(utils);
+    }
 
-    item->comp = Jscon_decode_composite(&utils->buffer, _jscon_count_element(utils->buffer));
-    Jscon_composite_link_r(item, &utils->last_accessed_comp);
+    _jscon_destroy_preorder(branch);
 }
 
 /* create nested composite type (object/array) and return 
-      the address. */
+      the address. the parser callback sees it before any of its
+      branches is built, and may prune it by returning NULL */
 static jscon_item_t*
 _jscon_composite_init(jscon_item_t *item, struct _jscon_utils_s *utils, jscon_create_value *value_setter)
 {
-    item = _jscon_branch_init(item);
-    item->key = utils->key;
-    utils->key = NULL;
+    jscon_item_t *parent = item;
+
+    item = _jscon_branch_init(item, utils);
+    _jscon_set_key(item, utils);
 
     (*value_setter)(item, utils);
     item = (utils->parse_cb)(item);
 
+    if (NULL == item){
+        _jscon_branch_prune(parent, utils);
+        return parent;
+    }
+
     return item;
 }
 
@@ -274,7 +362,6 @@ static jscon_item_t*
 _jscon_wrap_composite(jscon_item_t *item, struct _jscon_utils_s *utils)
 {
     ++utils->buffer; /* skips '}' or ']' */
-    Jscon_composite_build(item);
     return item->parent;
 }
 
@@ -282,14 +369,19 @@ _jscon_wrap_composite(jscon_item_t *item, struct _jscon_utils_s *utils)
 static jscon_item_t*
 _jscon_append_primitive(jscon_item_t *item, struct _jscon_utils_s *utils, jscon_create_value *value_setter)
 {
-    item = _jscon_branch_init(item);
-    item->key = utils->key;
-    utils->key = NULL;
+    item = _jscon_branch_init(item, utils);
+    _jscon_set_key(item, utils);
+
+    jscon_item_t *parent = item->parent;
 
     (*value_setter)(item, utils);
     item = (utils->parse_cb)(item);
 
-    return item->parent;
+    if (NULL == item){
+        _jscon_branch_prune(parent, utils);
+    }
+
+    return parent;
 }
 
 /* this routine is called when setting a branch of a composite type
@@ -352,6 +444,11 @@ token_error:
 static jscon_item_t*
 _jscon_array_build(jscon_item_t *item, struct _jscon_utils_s *utils)
 {
+    if (0 != utils->skip_depth){ /* resume skipping a pruned branch */
+        _jscon_skip_composite(utils);
+        return item;
+    }
+
     CONSUME_BLANK_CHARS(utils->buffer);
     switch (*utils->buffer){
     case ']':/*ARRAY WRAPPER DETECTED*/
@@ -361,17 +458,9 @@ _jscon_array_build(jscon_item_t *item, struct _jscon_utils_s *utils)
         CONSUME_BLANK_CHARS(utils->buffer);
     /* fall through */
     default:
-     {
-        /* creates numerical key for the array element */
-        char numkey[MAX_INTEGER_DIG];
-        snprintf(numkey, MAX_INTEGER_DIG-1, "%zu", item->comp->num_branch);
-
+        /* array elements keys are implicit (its position) */
         ASSERT_S(NULL == utils->key, jscon_strerror(JSCON_INT__NOT_FREED, utils->key));
-        utils->key = strdup(numkey);
-        ASSERT_S(NULL != utils->key, jscon_strerror(JSCON_EXT__OUT_MEM, utils->key));
-
         return _jscon_branch_build(item, utils);
-     }
     }
 
     /* token error checking done inside _jscon_branch_build */
@@ -383,6 +472,11 @@ _jscon_array_build(jscon_item_t *item, struct _jscon_utils_s *utils)
 static jscon_item_t*
 _jscon_object_build(jscon_item_t *item, struct _jscon_utils_s *utils)
 {
+    if (0 != utils->skip_depth){ /* resume skipping a pruned branch */
+        _jscon_skip_composite(utils);
+        return item;
+    }
+
     CONSUME_BLANK_CHARS(utils->buffer);
     switch (*utils->buffer){
     case '}':/*OBJECT WRAPPER DETECTED*/
@@ -392,17 +486,20 @@ _jscon_object_build(jscon_item_t *item, struct _jscon_utils_s *utils)
         CONSUME_BLANK_CHARS(utils->buffer);
     /* fall through */
     case '\"':/*KEY STRING DETECTED*/
+     {
         ASSERT_S(NULL == utils->key, jscon_strerror(JSCON_INT__NOT_FREED, utils->key));
-        utils->key = Jscon_decode_string(&utils->buffer);
+        utils->key = _jscon_decode_key(utils);
+        CONSUME_BLANK_CHARS(utils->buffer);
         ASSERT_S(':' == *utils->buffer, jscon_strerror(JSCON_EXT__INVALID_TOKEN, utils->buffer));
         ++utils->buffer; /* skips ':' */
         CONSUME_BLANK_CHARS(utils->buffer);
         return _jscon_branch_build(item, utils);
+     }
     default:
-        if (!IS_BLANK_CHAR(*utils->buffer))
+        /* blank chars have been consumed, only end of buffer is left */
+        if ('\0' != *utils->buffer)
             ERROR("%s", jscon_strerror(JSCON_EXT__INVALID_TOKEN, utils->buffer));
 
-        CONSUME_BLANK_CHARS(utils->buffer);
         return item;
     }
 }
@@ -438,9 +535,9 @@ _jscon_entity_build(jscon_item_t *item, struct _jscon_utils_s *utils)
 
         _jscon_value_set_null(item, utils);
         break;
-    case '-': case '1': case '2': case '3': 
-    case '4': case '5': case '6': case '7': 
-    case '8': case '9':
+    case '-': case '0': case '1': case '2': 
+    case '3': case '4': case '5': case '6': 
+    case '7': case '8': case '9':
         _jscon_value_set_number(item, utils);
         break;
     default:
@@ -461,34 +558,192 @@ _jscon_default_callback(jscon_item_t *item){
     return item;
 }
 
+/* callback evoked for every item created by the parser, shared by
+    every thread (parses read it as they start) */
+static _Atomic(jscon_cb*) _jscon_parse_cb = &_jscon_default_callback;
+
+/* install new_cb as the parser callback, used by every parse that
+    follows, or keep the current one if NULL. returns the callback that
+    was in use until then, so that it can be restored */
 jscon_cb*
 jscon_parse_cb(jscon_cb *new_cb)
 {
-    jscon_cb *parse_cb = &_jscon_default_callback;
-
     if (NULL != new_cb){
-        parse_cb = new_cb;
+        return atomic_exchange_explicit(&_jscon_parse_cb, new_cb, memory_order_acq_rel);
     }
 
-    return parse_cb;
+    return atomic_load_explicit(&_jscon_parse_cb, memory_order_acquire);
 }
 
-/* parse contents from buffer into a jscon item object
-    and return its root */
-jscon_item_t*
-jscon_parse(char *buffer)
+/* build items from buffer until its NUL terminator is reached, returns
+    the composite item being built, or NULL once the root is complete */
+static jscon_item_t*
+_jscon_build(jscon_item_t *item, struct _jscon_utils_s *utils)
 {
-    jscon_item_t *root = calloc(1, sizeof *root);
-    if (NULL == root) return NULL;
+    while ((NULL != item) && ('\0' != *utils->buffer)){
+        switch(item->type){
+        case JSCON_OBJECT:
+            item = _jscon_object_build(item, utils);
+            break;
+        case JSCON_ARRAY:
+            item = _jscon_array_build(item, utils);
+            break;
+        case JSCON_UNDEFINED: /* this should be true only at the first iteration */
+            item = _jscon_entity_build(item, utils);
+
+            if (IS_PRIMITIVE(item)) return NULL;
+
+            break;
+        default:
+            ERROR("Unknown item->type found\n\tCode: %d", item->type);
+        }
+    }
+
+    return item;
+}
 
+/* parse contents from buffer into a jscon item object and return its
+    root, items are allocated from arena if given, and flags change
+    parsing behavior (check enum jscon_parse_flags) */
+jscon_item_t*
+jscon_parse_ext(char *buffer, jscon_arena_t *arena, int flags)
+{
     struct _jscon_utils_s utils = {
         .buffer = buffer,
+        .arena = arena,
+        .flags = flags,
         .parse_cb = jscon_parse_cb(NULL),
     };
+
+    jscon_item_t *root = _jscon_item_init(&utils);
     
     /* build while item and buffer aren't nulled */
-    jscon_item_t *item = root;
-    while ((NULL != item) && ('\0' != *utils.buffer)){
+    jscon_item_t *item = _jscon_build(root, &utils);
+
+    /* reached end of buffer before wrapping every composite */
+    ASSERT_S(!IS_COMPOSITE(item), jscon_strerror(JSCON_EXT__INVALID_COMPOSITE, utils.buffer));
+
+    return root;
+}
+
+/* parse contents from buffer into a jscon item object
+    and return its root */
+jscon_item_t*
+jscon_parse(char *buffer){
+    return jscon_parse_ext(buffer, NULL, JSCON_PARSE_DEFAULT);
+}
+
+/* same as jscon_parse(), but every item is allocated from arena, and
+    released alongside it by jscon_arena_destroy() */
+jscon_item_t*
+jscon_parse_arena(jscon_arena_t *arena, char *buffer)
+{
+    ASSERT_S(NULL != arena, jscon_strerror(JSCON_EXT__EMPTY_FIELD, arena));
+    return jscon_parse_ext(buffer, arena, JSCON_PARSE_DEFAULT);
+}
+
+/* parse a buffer of len bytes which doesn't need to be NUL terminated,
+    into arena if given (flags other than in-situ apply). buffer is
+    validated first, as a valid composite
+    is wrapped before its end is reached, and is then built in place
+    without any copy */
+jscon_item_t*
+Jscon_parse_len(const char *buffer, size_t len, jscon_arena_t *arena, int flags)
+{
+    ASSERT_S(NULL != buffer, "Missing JSON text buffer");
+
+    long err_offset = jscon_validate(buffer, len);
+    if (-1 != err_offset){
+        ERROR("Invalid JSON text at offset %ld", err_offset);
+    }
+
+    const char *start = Jscon_skip_blank(buffer); /* validated, a token follows */
+    if ('{' == *start || '[' == *start){
+        /* buffer is only written to in-situ */
+        return jscon_parse_ext((char*)start, arena, flags & ~JSCON_PARSE_INSITU);
+    }
+
+    /* top-level primitive, its end can only be known by the terminator.
+        the copy is taken from arena if given, and reclaimed alongside it */
+    char *tmp = Jscon_strndup(arena, start, len - (start - buffer));
+    jscon_item_t *root = jscon_parse_ext(tmp, arena, flags & ~JSCON_PARSE_INSITU);
+    if (NULL == arena){
+        free(tmp);
+    }
+
+    return root;
+}
+
+/* same as jscon_parse(), but for a buffer of len bytes which doesn't
+    need to be NUL terminated */
+jscon_item_t*
+jscon_parse_len(const char *buffer, size_t len){
+    return Jscon_parse_len(buffer, len, NULL, JSCON_PARSE_DEFAULT);
+}
+
+/* JSCON DOCUMENT
+ *  storage that outlives the items parsed into it, so that it can be
+ *  reused by the next parse
+ *      arena: holds every item, key, string, branch and hashtable
+ *      root: the most recently parsed item, NULL if none */
+struct jscon_doc_s {
+    jscon_arena_t *arena;
+    jscon_item_t *root;
+};
+
+jscon_doc_t*
+jscon_doc_init(void)
+{
+    jscon_doc_t *new_doc = calloc(1, sizeof *new_doc);
+    ASSERT_S(NULL != new_doc, jscon_strerror(JSCON_EXT__OUT_MEM, new_doc));
+
+    new_doc->arena = jscon_arena_init();
+    ASSERT_S(NULL != new_doc->arena, jscon_strerror(JSCON_EXT__OUT_MEM, new_doc->arena));
+
+    return new_doc;
+}
+
+/* release doc, and the last item parsed into it */
+void
+jscon_doc_destroy(jscon_doc_t *doc)
+{
+    if (NULL == doc) return;
+
+    jscon_arena_destroy(doc->arena);
+    free(doc);
+}
+
+/* same as jscon_parse_len(), but doc's previous item is discarded and
+    its memory reused for the new one, which only has to grow if it
+    doesn't fit. the item is valid until doc is parsed into again */
+jscon_item_t*
+jscon_parse_into(jscon_doc_t *doc, const char *buffer, size_t len)
+{
+    ASSERT_S(NULL != doc, jscon_strerror(JSCON_EXT__EMPTY_FIELD, doc));
+
+    Jscon_arena_reset(doc->arena);
+    doc->root = Jscon_parse_len(buffer, len, doc->arena, JSCON_PARSE_DEFAULT);
+
+    return doc->root;
+}
+
+/* build the elements of array found within [start,end), where end is
+    the ',' or ']' that follows the last of them */
+void
+Jscon_build_elements(jscon_item_t *array, const char *start, const char *end)
+{
+    struct _jscon_utils_s utils = {
+        .buffer = (char*)start, /* only written to in-situ */
+        .parse_cb = jscon_parse_cb(NULL),
+    };
+
+    jscon_item_t *item = array;
+    while (1){
+        if (array == item){ /* stop in between elements */
+            CONSUME_BLANK_CHARS(utils.buffer);
+            if (utils.buffer >= end) break;
+        }
+
         switch(item->type){
         case JSCON_OBJECT:
             item = _jscon_object_build(item, &utils);
@@ -496,16 +751,202 @@ jscon_parse(char *buffer)
         case JSCON_ARRAY:
             item = _jscon_array_build(item, &utils);
             break;
-        case JSCON_UNDEFINED: /* this should be true only at the first iteration */
-            item = _jscon_entity_build(item, &utils);
+        default:
+            ERROR("Unknown item->type found\n\tCode: %d", item->type);
+        }
+    }
+}
+
+/* parse the JSON text file at path, which is memory mapped instead of
+    read into a buffer */
+jscon_item_t*
+jscon_parse_file(const char *path)
+{
+    ASSERT_S(NULL != path, "Missing file path");
+
+    int fd = open(path, O_RDONLY);
+    if (-1 == fd){
+        ERROR("Couldn't open '%s': %s", path, strerror(errno));
+    }
+
+    struct stat st;
+    if (-1 == fstat(fd, &st)){
+        ERROR("Couldn't stat '%s': %s", path, strerror(errno));
+    }
+    if (0 == st.st_size){
+        ERROR("Empty file '%s'", path);
+    }
+
+    size_t len = (size_t)st.st_size;
+    char *buffer = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (MAP_FAILED == buffer){
+        ERROR("Couldn't map '%s': %s", path, strerror(errno));
+    }
+    close(fd);
+
+    /* the text is traversed once, front to back */
+    posix_madvise(buffer, len, POSIX_MADV_SEQUENTIAL);
+
+    jscon_item_t *root = jscon_parse_len(buffer, len);
+
+    munmap(buffer, len);
+
+    return root;
+}
+
+/* STREAMING PARSER
+ *  chunks are appended to a pending buffer, which is scanned for the
+ *  last position where a build iteration ends (a cut): right after
+ *  '{', '[', '}' or ']', or right after the value preceding a ','.
+ *  everything before the cut is built and discarded, so only the
+ *  trailing incomplete token (string, number or literal) is kept
+ *  across chunk boundaries */
+struct jscon_parser_s {
+    struct _jscon_utils_s utils;
+    jscon_item_t *root;
+    jscon_item_t *item; /* composite being built, NULL once root is complete */
+
+    char *pending; /* unbuilt input, always NUL terminated */
+    size_t len;
+    size_t cap;
+
+    size_t scan_pos; /* next pending byte to be scanned */
+    size_t cut_pos; /* pending bytes before it can be built */
+    bool in_string; /* scan_pos is inside a string */
+    bool escaped; /* scan_pos is at an escaped char */
+};
+
+/* items are allocated from arena if given, heap otherwise */
+jscon_parser_t*
+jscon_parser_new(jscon_arena_t *arena)
+{
+    jscon_parser_t *new_parser = calloc(1, sizeof *new_parser);
+    ASSERT_S(NULL != new_parser, jscon_strerror(JSCON_EXT__OUT_MEM, new_parser));
+
+    new_parser->utils.arena = arena;
+    new_parser->utils.flags = JSCON_PARSE_DEFAULT; /* pending buffer is reused */
+    new_parser->utils.parse_cb = jscon_parse_cb(NULL);
+
+    new_parser->root = _jscon_item_init(&new_parser->utils);
+    new_parser->item = new_parser->root;
 
-            if (IS_PRIMITIVE(item)) return item;
+    return new_parser;
+}
+
+/* scan newly fed bytes for the last cut, keeping track of strings so
+    that delimiters inside of them are ignored */
+static void
+_jscon_parser_scan(jscon_parser_t *parser)
+{
+    char *str = parser->pending + parser->scan_pos;
+    char *end = parser->pending + parser->len;
+
+    while (str < end){
+        if (parser->escaped){
+            parser->escaped = false;
+            ++str;
+            continue;
+        }
+
+        if (parser->in_string){
+            /* jump straight to the next double quotes or escape */
+            str = Jscon_find_token(str, '\"', '\\', '\\');
+            if (str >= end) break; /* NUL terminator */
+
+            if ('\\' == *str)
+                parser->escaped = true;
+            else
+                parser->in_string = false;
+            ++str;
+            continue;
+        }
 
+        switch (*str){
+        case '\"':
+            parser->in_string = true;
+            break;
+        case '{': case '[':
+        case '}': case ']':
+            parser->cut_pos = str + 1 - parser->pending;
+            break;
+        case ',':
+         {
+            char *tmp = str;
+            while (tmp > parser->pending && IS_BLANK_CHAR(tmp[-1])){
+                --tmp;
+            }
+            if ((size_t)(tmp - parser->pending) > parser->cut_pos){
+                parser->cut_pos = tmp - parser->pending;
+            }
             break;
+         }
         default:
-            ERROR("Unknown item->type found\n\tCode: %d", item->type);
+            break;
         }
+        ++str;
     }
 
+    parser->scan_pos = end - parser->pending;
+}
+
+/* append chunk to parser, and build every item it completes */
+void
+jscon_parser_feed(jscon_parser_t *parser, const char *chunk, size_t len)
+{
+    if (NULL == parser->item) return; /* root is complete */
+
+    if (parser->len + len + 1 > parser->cap){
+        size_t new_cap = (0 == parser->cap) ? 4096 : parser->cap;
+        while (new_cap < parser->len + len + 1){
+            new_cap *= 2;
+        }
+
+        char *tmp = realloc(parser->pending, new_cap);
+        ASSERT_S(NULL != tmp, jscon_strerror(JSCON_EXT__OUT_MEM, tmp));
+
+        parser->pending = tmp;
+        parser->cap = new_cap;
+    }
+    memcpy(parser->pending + parser->len, chunk, len);
+    parser->len += len;
+    parser->pending[parser->len] = '\0';
+
+    _jscon_parser_scan(parser);
+    if (0 == parser->cut_pos) return;
+
+    /* build up to the cut, which is NUL terminated meanwhile */
+    size_t cut = parser->cut_pos;
+    char tmp = parser->pending[cut];
+    parser->pending[cut] = '\0';
+
+    parser->utils.buffer = parser->pending;
+    parser->item = _jscon_build(parser->item, &parser->utils);
+
+    parser->pending[cut] = tmp;
+
+    /* discard built input */
+    memmove(parser->pending, parser->pending + cut, parser->len - cut + 1);
+    parser->len -= cut;
+    parser->scan_pos -= cut;
+    parser->cut_pos = 0;
+}
+
+/* build whatever input is left, free the parser and return the root */
+jscon_item_t*
+jscon_parser_finish(jscon_parser_t *parser)
+{
+    if (NULL != parser->item && NULL != parser->pending){
+        parser->utils.buffer = parser->pending;
+        parser->item = _jscon_build(parser->item, &parser->utils);
+    }
+
+    /* reached end of input before wrapping every composite */
+    ASSERT_S(!IS_COMPOSITE(parser->item), jscon_strerror(JSCON_EXT__INVALID_COMPOSITE, parser->item));
+
+    jscon_item_t *root = parser->root;
+
+    free(parser->pending);
+    free(parser);
+
     return root;
 }
@@ -49,6 +49,7 @@ _jscon_new(const char *key, enum jscon_type type)
 
     new_item->parent = NULL;
     new_item->type = type;
+    new_item->flags = 0;
 
     return new_item;
 }
@@ -128,19 +129,13 @@ _jscon_composite(const char *key, enum jscon_type type)
     new_item->comp = calloc(1, sizeof *new_item->comp);
     if (NULL == new_item->comp) goto cleanupA;
 
-    new_item->comp->hashtable = hashtable_init(); 
-    if (NULL == new_item->comp->hashtable) goto cleanupB;
-
     new_item->comp->branch = malloc(sizeof(jscon_item_t*));
-    if (NULL == new_item->comp->branch) goto cleanupC;
-
-    Jscon_composite_build(new_item);
+    if (NULL == new_item->comp->branch) goto cleanupB;
+    new_item->comp->cap_branch = 1;
 
     return new_item;
 
 
-cleanupC:
-    hashtable_destroy(new_item->comp->hashtable);
 cleanupB:
     free(new_item->comp);
 cleanupA:
@@ -166,36 +161,97 @@ jscon_size(const jscon_item_t *item){
     return IS_COMPOSITE(item) ? item->comp->num_branch : 0;
 } 
 
+/* key lookups build their object's hashtable on demand, this builds
+ *  it upfront for item and all of its nested objects, so that further
+ *  lookups won't modify the tree (small objects are scanned instead) */
+void
+jscon_build_index(jscon_item_t *item)
+{
+    if (!IS_COMPOSITE(item)) return;
+
+    if (JSCON_OBJECT == item->type && NULL == item->comp->hashtable
+        && item->comp->num_branch > MAX_SCAN_BRANCH)
+    {
+        Jscon_composite_build(item);
+    }
+
+    for (size_t i=0; i < item->comp->num_branch; ++i){
+        jscon_build_index(item->comp->branch[i]);
+    }
+}
+
+/* resize item's branch array, a borrowed array (ex: from an arena) is
+ *  copied to a new heap array which is then owned by the item */
+static bool
+_jscon_branch_resize(jscon_item_t *item, size_t new_cap)
+{
+    jscon_item_t **tmp;
+    if (item->flags & JSCON_BORROWED_BRANCH){
+        tmp = malloc(new_cap * sizeof(jscon_item_t*));
+        if (NULL == tmp) return false;
+
+        size_t num_copy = (item->comp->num_branch < new_cap) ? item->comp->num_branch : new_cap;
+        if (0 != num_copy){ /* an empty composite may have no array */
+            memcpy(tmp, item->comp->branch, num_copy * sizeof(jscon_item_t*));
+        }
+
+        item->flags &= ~JSCON_BORROWED_BRANCH;
+    } else {
+        tmp = realloc(item->comp->branch, new_cap * sizeof(jscon_item_t*));
+        if (NULL == tmp) return false;
+    }
+
+    item->comp->branch = tmp;
+    item->comp->cap_branch = new_cap;
+
+    return true;
+}
+
+#define MAX_STALE_BRANCH 16
+
+/* get item position at its parent branch array. removals shift the
+ *  branches that follow without updating their index, so an index from
+ *  parent's stale_branch on may be ahead of the actual position by up
+ *  to num_stale, and the position is searched for backwards from it.
+ *  the tree is only read, so that many threads may look it up at once
+ *  (jscon_dettach() renumbers the branches once there's too many) */
 static size_t
-_jscon_depth(jscon_item_t *item)
+_jscon_branch_index(const jscon_item_t *item)
 {
-    size_t depth = 0;
-    while (!IS_ROOT(item)){
-        item = item->parent;
-        ++depth;
+    ASSERT_S(!IS_ROOT(item), "Item is root (has no position)");
+
+    const jscon_composite_t *parent_comp = item->parent->comp;
+    if (0 == parent_comp->num_stale || item->index < parent_comp->stale_branch){
+        return item->index;
+    }
+
+    size_t i = (item->index < parent_comp->num_branch) ? item->index : parent_comp->num_branch - 1;
+    size_t i_min = (item->index > parent_comp->num_stale) ? item->index - parent_comp->num_stale : 0;
+    while (i >= i_min && i < parent_comp->num_branch){
+        if (item == parent_comp->branch[i]) return i;
+        --i; /* wraps around past 0, ending the loop */
     }
 
-    return depth;
+    ERROR("Item is not referenced by parent");
+    abort();
 }
 
-/* get the last comp relative to the item */
-static jscon_composite_t*
-_jscon_get_deepest(jscon_item_t *item)
+/* make room for n branches at item, so that appending up to that many
+ *  won't have to grow it (or its hashtable) again */
+bool
+jscon_reserve(jscon_item_t *item, size_t n)
 {
     ASSERT_S(IS_COMPOSITE(item), jscon_strerror(JSCON_EXT__NOT_COMPOSITE, item));
 
-    size_t item_depth = _jscon_depth(item);
+    if (n > item->comp->cap_branch){
+        if (!_jscon_branch_resize(item, n)) return false;
+    }
 
-    /* get the deepest nested composite relative to item */
-    jscon_composite_t *comp_last = item->comp;
-    while(NULL != comp_last->next){
-        if (item_depth > _jscon_depth(comp_last->next->p_item)){
-            break;
-        }
-        comp_last = comp_last->next;
+    if (NULL != item->comp->hashtable){
+        hashtable_build(item->comp->hashtable, n);
     }
 
-    return comp_last;
+    return true;
 }
 
 jscon_item_t*
@@ -203,65 +259,44 @@ jscon_append(jscon_item_t *item, jscon_item_t *new_branch)
 {
     ASSERT_S(new_branch != item, "Can't perform circular append");
 
-    char *hold_key = NULL; /* hold new_branch->key incase we can't allocate memory for new numerical key */
     switch (item->type){
     case JSCON_ARRAY:
-     {
-        hold_key = new_branch->key; 
-
-        char numkey[MAX_INTEGER_DIG];
-        snprintf(numkey, MAX_INTEGER_DIG-1, "%zu", item->comp->num_branch);
-
-        new_branch->key = strdup(numkey);
-        if (NULL == new_branch->key) goto cleanupA; /* Out of memory, reattach its old key and return NULL */
-     }
-    /* fall through */
     case JSCON_OBJECT:
         break;
     default:
         ERROR("Can't append to\n\t%s", jscon_strerror(JSCON_EXT__NOT_COMPOSITE, item));
     }
 
-    /* realloc parent references to match new size */
-    jscon_item_t **tmp = realloc(item->comp->branch, (1+item->comp->num_branch) * sizeof(jscon_item_t*));
-    if (NULL == tmp) goto cleanupB;
+    /* grow geometrically, so that appending is amortized O(1) */
+    if (item->comp->num_branch == item->comp->cap_branch){
+        size_t new_cap = (0 == item->comp->cap_branch) ? 4 : 2 * item->comp->cap_branch;
+        if (!_jscon_branch_resize(item, new_cap)) return NULL;
+    }
 
-    item->comp->branch = tmp;
+    /* array elements keys are implicit (its position), so the
+     *  new branch key is discarded */
+    if (JSCON_ARRAY == item->type && NULL != new_branch->key){
+        if (!(new_branch->flags & JSCON_BORROWED_KEY)){
+            free(new_branch->key);
+        }
+        new_branch->key = NULL;
+        new_branch->flags &= ~JSCON_BORROWED_KEY;
+    }
 
     ++item->comp->num_branch;
 
     item->comp->branch[item->comp->num_branch-1] = new_branch;
     new_branch->parent = item;
+    new_branch->index = item->comp->num_branch-1;
 
-    if (item->comp->num_branch <= item->comp->hashtable->num_bucket){
+    /* update hashtable only if its already been built */
+    if (NULL != item->comp->hashtable){
         Jscon_composite_set(new_branch->key, new_branch);
-    } else {
-        Jscon_composite_remake(item);
-    }
-
-    if (IS_COMPOSITE(new_branch)){
-        /* get the last comp relative to item */
-        jscon_composite_t *comp_last = _jscon_get_deepest(item);
-        comp_last->next = new_branch->comp;
-        new_branch->comp->prev = comp_last;
-    }
-
-    if (hold_key != NULL){
-        free(hold_key);
     }
 
     return new_branch;
-
-cleanupB:
-    if (hold_key != NULL)
-        free(new_branch->key);
-cleanupA:
-    new_branch->key = hold_key;
-
-    return NULL;
 }
 
-/* @todo test this */
 jscon_item_t*
 jscon_dettach(jscon_item_t *item)
 {
@@ -270,35 +305,34 @@ jscon_dettach(jscon_item_t *item)
 
     /* get the item index reference from its parent */
     jscon_item_t *item_parent = item->parent;
+    jscon_composite_t *parent_comp = item_parent->comp;
+    size_t item_index = _jscon_branch_index(item);
+
+    /* dettach the item from its parent, the branches that follow are
+     *  shifted back but keep their index until they're looked up */
+    memmove(&parent_comp->branch[item_index], &parent_comp->branch[item_index+1],
+            (parent_comp->num_branch - item_index - 1) * sizeof(jscon_item_t*));
+    --parent_comp->num_branch;
+    parent_comp->branch[parent_comp->num_branch] = NULL;
+
+    if (item_index < parent_comp->num_branch){
+        if (0 == parent_comp->num_stale || item_index < parent_comp->stale_branch){
+            parent_comp->stale_branch = item_index;
+        }
 
-    /* realloc parent references to match new size */
-    jscon_item_t **tmp = realloc(item_parent->comp->branch, jscon_size(item_parent) * sizeof(jscon_item_t*));
-    if (NULL == tmp) return NULL;
-
-    item_parent->comp->branch = tmp;
-
-    /* dettach the item from its parent and reorder keys */
-    for (size_t i = jscon_get_index(item_parent, item->key); i < jscon_size(item_parent)-1; ++i){
-        item_parent->comp->branch[i] = item_parent->comp->branch[i+1]; 
+        /* keep lookups short, by renumbering after too many removals */
+        if (++parent_comp->num_stale > MAX_STALE_BRANCH){
+            for (size_t i = parent_comp->stale_branch; i < parent_comp->num_branch; ++i){
+                parent_comp->branch[i]->index = i;
+            }
+            parent_comp->num_stale = 0;
+        }
     }
-    item_parent->comp->branch[jscon_size(item_parent)-1] = NULL;
-    --item_parent->comp->num_branch;
-
-    /* parent hashtable has to be remade, to match reordered keys */
-    Jscon_composite_remake(item_parent);
 
-    /* get the immediate previous comp relative to the item */
-    jscon_composite_t *comp_prev = item->comp->prev;
-    /* get the last comp relative to item */
-    jscon_composite_t *comp_last = _jscon_get_deepest(item);
-
-    /* remove tree references to the item */
-    comp_prev->next = comp_last->next;
-
-    /* remove item references to the tree */
+    /* only its own key has to leave parent's hashtable */
+    Jscon_composite_unset(item);
+    item->index = 0;
     item->parent = NULL;
-    comp_last->next = NULL;
-    item->comp->prev = NULL;
 
     return item;
 }
@@ -314,6 +348,34 @@ jscon_delete(jscon_item_t *item, const char *key)
 }
 
 
+/* next item after item in preorder, that is either its first branch, or
+ *  the branch that follows it or its closest parent with one left. the
+ *  subtree of root isn't left if given, and only composites are
+ *  considered if composite_only is set. the tree is only read */
+static jscon_item_t*
+_jscon_preorder_next(const jscon_item_t *item, const jscon_item_t *root, bool composite_only)
+{
+    const jscon_item_t *current = item;
+    size_t i = 0;
+    while (1){
+        if (IS_COMPOSITE(current)){
+            for (; i < current->comp->num_branch; ++i){
+                jscon_item_t *branch = current->comp->branch[i];
+                if (!composite_only || IS_COMPOSITE(branch)){
+                    return branch;
+                }
+            }
+        }
+
+        if (current == root || IS_ROOT(current)){
+            return NULL;
+        }
+
+        i = _jscon_branch_index(current) + 1;
+        current = current->parent;
+    }
+}
+
 /* reentrant function, works similar to strtok. the starting point is set
  *  by doing the function call before the main iteration loop, then
  *  consecutive function calls inside the loop will continue the iteration
@@ -334,101 +396,192 @@ jscon_iter_composite_r(jscon_item_t *item, jscon_item_t **p_current_item)
         return NULL;
     }
 
-    /* get next comp in line, if NULL it means there are no more
-     *  composite datatype items to iterate through */
-    jscon_composite_t *next_comp = (*p_current_item)->comp->next;
-    if (NULL == next_comp){
-        /* reach end of composite items */
-        return *p_current_item = NULL;
+    return *p_current_item = _jscon_preorder_next(*p_current_item, NULL, true);
+}
+
+#define MAX_ITER_WALK 4 /* jscon_iter_next() walks a thread may interleave */
+
+/* return the item that follows item in preorder, until the end of the
+ *  subtree the walk started at. walks are kept thread local, and one is
+ *  carried on if item is what it returned last, otherwise a new walk
+ *  starts at item. a few walks may be interleaved (two trees compared
+ *  side by side), but a walk nested in another one is taken for the
+ *  outer walk (use jscon_iter_init() for that). the tree is only read */
+jscon_item_t*
+jscon_iter_next(jscon_item_t *item)
+{
+    static _Thread_local struct {
+        const jscon_item_t *root; /* item the walk started at */
+        jscon_item_t *current; /* item it returned last, NULL once over */
+    } walk[MAX_ITER_WALK];
+    static _Thread_local size_t oldest_walk;
+
+    if (NULL == item) return NULL;
+
+    size_t i = 0;
+    while (i < MAX_ITER_WALK && item != walk[i].current){
+        ++i;
+    }
+    if (MAX_ITER_WALK == i){ /* a new walk starts, over a finished one if any */
+        for (i=0; i < MAX_ITER_WALK && NULL != walk[i].current; ++i)
+            continue;
+        if (MAX_ITER_WALK == i){
+            i = oldest_walk;
+            oldest_walk = (oldest_walk + 1) % MAX_ITER_WALK;
+        }
+        walk[i].root = item;
     }
 
-    /* update current_item and return next composite */
-    return *p_current_item = next_comp->p_item;
+    return walk[i].current = _jscon_preorder_next(item, walk[i].root, false);
 }
 
-/* return next (not yet accessed) item, by using item->comp->last_accessed_branch as the branch index */
-static inline jscon_item_t*
-_jscon_push(jscon_item_t *item)
+/* set iter to walk item (check enum jscon_iter_mode), the whole state is
+ *  kept at iter so that any amount of iterators may walk the same tree
+ *  at once, even from different threads, as long as its not modified */
+void
+jscon_iter_init(jscon_iter_t *iter, jscon_item_t *item, enum jscon_iter_mode mode)
 {
-    ASSERT_S(IS_COMPOSITE(item), jscon_strerror(JSCON_EXT__NOT_COMPOSITE, item));
-    ASSERT_S(item->comp->last_accessed_branch < item->comp->num_branch, jscon_strerror(JSCON_INT__OVERFLOW, item->comp));
+    ASSERT_S(NULL != iter, jscon_strerror(JSCON_EXT__EMPTY_FIELD, iter));
+
+    iter->root = item;
+    iter->mode = mode;
 
-    ++item->comp->last_accessed_branch; /* update last_accessed_branch to next */
-    jscon_item_t *next_item = item->comp->branch[item->comp->last_accessed_branch-1];
+    switch (mode){
+    case JSCON_ITER_ALL:
+        iter->next = item;
+        break;
+    case JSCON_ITER_COMPOSITE:
+        iter->next = IS_COMPOSITE(item) ? item : NULL;
+        break;
+    case JSCON_ITER_BRANCH:
+        iter->next = (jscon_size(item) > 0) ? item->comp->branch[0] : NULL;
+        break;
+    default:
+        ERROR("Unknown iterator mode\n\tCode: %d", mode);
+    }
+}
+
+/* return the next item of iter, NULL once there are none left */
+jscon_item_t*
+jscon_iter_step(jscon_iter_t *iter)
+{
+    jscon_item_t *item = iter->next;
+    if (NULL == item) return NULL;
 
-    if (IS_COMPOSITE(next_item)){
-        /* resets next_item that might have been set from a different run */
-        next_item->comp->last_accessed_branch = 0;
+    switch (iter->mode){
+    case JSCON_ITER_ALL:
+        iter->next = _jscon_preorder_next(item, iter->root, false);
+        break;
+    case JSCON_ITER_COMPOSITE:
+        iter->next = _jscon_preorder_next(item, iter->root, true);
+        break;
+    case JSCON_ITER_BRANCH: {
+        size_t i = _jscon_branch_index(item) + 1;
+        iter->next = (i < iter->root->comp->num_branch) ? iter->root->comp->branch[i] : NULL;
+        break; }
+    default:
+        ERROR("Unknown iterator mode\n\tCode: %d", iter->mode);
     }
 
-    return next_item;
+    return item;
 }
 
-static inline jscon_item_t*
-_jscon_pop(jscon_item_t *item)
+static jscon_item_t* _jscon_clone_preorder(const jscon_item_t *item, jscon_arena_t *arena);
+
+/* copy item's composite to new_item, branches are copied in the same
+ *  order and the hashtable (if built) keeps its layout, only its keys
+ *  and values are swapped for the new ones */
+static void
+_jscon_composite_clone(jscon_item_t *new_item, const jscon_item_t *item, jscon_arena_t *arena)
 {
-    if (IS_COMPOSITE(item)){
-        /* resets object's last_accessed_branch */
-        item->comp->last_accessed_branch = 0;
+    const jscon_composite_t *comp = item->comp;
+
+    jscon_composite_t *new_comp = Jscon_alloc(arena, sizeof *new_comp);
+    new_comp->arena = arena;
+    new_item->comp = new_comp;
+
+    if (0 != comp->num_branch){
+        new_comp->branch = Jscon_alloc(arena, comp->num_branch * sizeof(jscon_item_t*));
+        new_comp->cap_branch = comp->num_branch;
     }
 
-    return item->parent;
+    for (size_t i=0; i < comp->num_branch; ++i){
+        jscon_item_t *new_branch = _jscon_clone_preorder(comp->branch[i], arena);
+        new_branch->parent = new_item;
+        new_branch->index = i;
+
+        new_comp->branch[i] = new_branch;
+        ++new_comp->num_branch;
+    }
+
+    if (NULL == comp->hashtable) return;
+
+    new_comp->hashtable = (NULL != arena)
+                            ? hashtable_clone(comp->hashtable, &Jscon_arena_calloc_cb, arena)
+                            : hashtable_clone(comp->hashtable, NULL, NULL);
+
+    hashtable_t *new_hashtable = new_comp->hashtable;
+    for (size_t i=0; i < new_hashtable->num_slot; ++i){
+        if (NULL == new_hashtable->slot[i].key) continue;
+
+        jscon_item_t *new_branch = new_comp->branch[_jscon_branch_index(new_hashtable->slot[i].value)];
+        new_hashtable->slot[i].key = new_branch->key;
+        new_hashtable->slot[i].value = new_branch;
+    }
 }
 
-/* this will simulate tree preorder traversal iteratively, by using 
- *  item->comp->last_accessed_branch like a stack frame. under no circumstance 
- *  should you modify last_accessed_branch value directly */
-jscon_item_t*
-jscon_iter_next(jscon_item_t *item)
+/* copy item and all of its nested items, allocated from arena if
+ *  given. the copy is a root that keeps item's key */
+static jscon_item_t*
+_jscon_clone_preorder(const jscon_item_t *item, jscon_arena_t *arena)
 {
-    if (NULL == item) return NULL;
+    jscon_item_t *new_item = Jscon_alloc(arena, sizeof *new_item);
+    *new_item = *item; /* value is copied exactly, no text roundtrip */
 
-    /* resets root's last_accessed_branch in case its set from a different run */
-    if (IS_COMPOSITE(item)){
-        item->comp->last_accessed_branch = 0;
+    new_item->parent = NULL;
+    new_item->index = 0;
+    /* resources taken from the arena are released alongside it */
+    new_item->flags = (NULL != arena) ? JSCON_BORROWED_ALL : 0;
+
+    if (NULL != item->key){
+        new_item->key = Jscon_strndup(arena, item->key, strlen(item->key));
     }
 
-    if (IS_LEAF(item)){
-        /* item is a leaf, fetch parent until found a item with any branch
-         *  left to be accessed */
-        do {
-            /* fetch parent until a item with unacessed branch is found */
-            item = _jscon_pop(item);
-            if ((NULL == item) || (0 == item->comp->last_accessed_branch)){
-                /* item is unexistent (root's parent) or all of 
-                 *  its branches have been accessed */
-                return NULL;
-            }
-        } while (item->comp->num_branch == item->comp->last_accessed_branch);
+    switch (item->type){
+    case JSCON_STRING:
+        new_item->string = Jscon_strndup(arena, item->string, strlen(item->string));
+        break;
+    case JSCON_OBJECT:
+    case JSCON_ARRAY:
+        _jscon_composite_clone(new_item, item, arena);
+        break;
+    default:
+        break;
     }
 
-    return _jscon_push(item);
+    return new_item;
 }
 
-/* This is not the most effective way to clone a item, but it is
- *  the most reliable, because it automatically accounts for any
- *  new feature that might added in the future. By first stringfying the
- *  (to be cloned) Item and then parsing the resulting string into
- *  a new clone Item, it's guaranteed that it will be a perfect 
- *  clone, with its unique hashtable, strings, etc */
+/* copy item into a new tree, walking it once. its items are
+ *  individually allocated, so that the clone can be modified and
+ *  released like any other tree */
 jscon_item_t*
 jscon_clone(jscon_item_t *item)
 {
     if (NULL == item) return NULL;
 
-    char *tmp_buffer = jscon_stringify(item, JSCON_ANY);
-    jscon_item_t *clone = jscon_parse(tmp_buffer);
-    free(tmp_buffer);
+    return _jscon_clone_preorder(item, NULL);
+}
 
-    if (NULL != item->key){
-        clone->key = strdup(item->key);
-        if (NULL == clone->key){
-            jscon_destroy(clone);
-            clone = NULL;
-        }
-    }
+/* same as jscon_clone(), but every item is allocated from arena, and
+ *  released alongside it by jscon_arena_destroy() */
+jscon_item_t*
+jscon_clone_arena(jscon_arena_t *arena, jscon_item_t *item)
+{
+    ASSERT_S(NULL != arena, jscon_strerror(JSCON_EXT__EMPTY_FIELD, arena));
+    if (NULL == item) return NULL;
 
-    return clone;
+    return _jscon_clone_preorder(item, arena);
 }
 
 char*
@@ -481,8 +634,11 @@ jscon_typecmp(const jscon_item_t *item, const enum jscon_type type){
 }
 
 int
-jscon_keycmp(const jscon_item_t *item, const char *key){
-    return (NULL != item->key) ? STREQ(item->key, key) : 0;
+jscon_keycmp(const jscon_item_t *item, const char *key)
+{
+    char numkey[MAX_INTEGER_DIG+1];
+    char *item_key = jscon_get_key_r(item, numkey, sizeof(numkey));
+    return (NULL != item_key) ? STREQ(item_key, key) : 0;
 }
 
 int
@@ -530,7 +686,7 @@ jscon_get_sibling(const jscon_item_t* item, const size_t relative_index)
     ASSERT_S(!IS_ROOT(item), "Item is root (has no siblings)");
 
     /* get parent's branch index of the origin item */
-    size_t item_index = jscon_get_index(item->parent, item->key);
+    size_t item_index = _jscon_branch_index(item);
 
     if ((0 <= (int)(item_index + relative_index)) 
         && jscon_size(item->parent) > (item_index + relative_index)){
@@ -562,16 +718,7 @@ jscon_get_index(const jscon_item_t *item, const char *key)
 
     if (NULL == lookup_item) return -1;
 
-    /* @todo currently this is O(n), a possible alternative
-     *  is adding a new attribute that stores the item's index */
-    for (size_t i=0; i < item->comp->num_branch; ++i){
-        if (lookup_item == item->comp->branch[i]){
-            return i;
-        }
-    }
-
-    ERROR("Item exists in hashtable but is not referenced by parent");
-    abort();
+    return _jscon_branch_index(lookup_item);
 }
 
 enum jscon_type
@@ -579,9 +726,27 @@ jscon_get_type(const jscon_item_t *item){
     return (NULL != item) ? item->type : JSCON_UNDEFINED;
 }
 
+/* array elements keys are implicit, so its numerical key is generated
+ *  from the element position into buf, which must fit size bytes */
 char*
-jscon_get_key(const jscon_item_t *item){
-    return (NULL != item) ? item->key : NULL;
+jscon_get_key_r(const jscon_item_t *item, char buf[], size_t size)
+{
+    if (NULL == item) return NULL;
+    if (IS_ROOT(item) || !IS_ELEMENT(item)) return item->key;
+
+    ASSERT_S(NULL != buf && 0 != size, jscon_strerror(JSCON_EXT__EMPTY_FIELD, buf));
+    snprintf(buf, size, "%zu", _jscon_branch_index(item));
+
+    return buf;
+}
+
+/* same as jscon_get_key_r(), but array element keys are stored in a
+ *  thread local buffer that is overwritten by the next call */
+char*
+jscon_get_key(const jscon_item_t *item)
+{
+    static _Thread_local char numkey[MAX_INTEGER_DIG+1];
+    return jscon_get_key_r(item, numkey, sizeof(numkey));
 }
 
 bool
@@ -630,11 +795,13 @@ jscon_set_boolean(jscon_item_t *item, bool boolean)
 jscon_item_t*
 jscon_set_string(jscon_item_t *item, char *string)
 {
-    if (item->string){
+    if (item->string && !(item->flags & JSCON_BORROWED_STRING)){
       free(item->string);
     }
 
     item->string = strdup(string);
+    item->flags &= ~JSCON_BORROWED_STRING;
+
     return item;
 }
 
@@ -35,6 +35,7 @@
 
 struct utils_s {
     char *buffer;   /* the json string to be parsed */
+    char *end;      /* end of the json string */
     char key[256];  /* holds key ptr to be received by item */
     long offset;    /* key offset used for concatenating unique keys for nested objects */
 };
@@ -49,15 +50,13 @@ struct pair_s {
 inline static void
 skip_string(struct utils_s *utils)
 {
-    /* loops until null terminator or end of string are found */
-    do {
-        /* skips escaped characters */
-        if ('\\' == *utils->buffer++){
-            ++utils->buffer;
-        }
-    } while ('\0' != *utils->buffer && '\"' != *utils->buffer);
-    ASSERT_S('\"' == *utils->buffer, jscon_strerror(JSCON_EXT__INVALID_STRING, utils->buffer));
-    ++utils->buffer; /* skip double quotes */
+    /* jumps until null terminator or end of string are found */
+    char *end = Jscon_find_token(utils->buffer + 1, '\"', '\\', '\\');
+    while ('\\' == *end && '\0' != end[1]){ /* skips escaped characters */
+        end = Jscon_find_token(end + 2, '\"', '\\', '\\');
+    }
+    ASSERT_S('\"' == *end, jscon_strerror(JSCON_EXT__INVALID_STRING, end));
+    utils->buffer = end + 1; /* skip double quotes */
 }
 
 inline static void
@@ -68,6 +67,8 @@ skip_composite(int ldelim, int rdelim, struct utils_s *utils)
      *  if not treated as a string will incorrectly trigger depth action*/
     int depth = 0;
     do {
+        /* jumps straight to the next token that impacts depth */
+        utils->buffer = Jscon_find_token(utils->buffer, '\"', ldelim, rdelim);
         if ('\"' == *utils->buffer){ /* treat string separately */
             skip_string(utils);
             continue; /* all necessary tokens skipped, and doesn't impact depth */
@@ -75,6 +76,8 @@ skip_composite(int ldelim, int rdelim, struct utils_s *utils)
             ++depth;
         } else if (rdelim == *utils->buffer) {
             --depth;
+        } else { /* null terminator reached */
+            return;
         }
 
         ++utils->buffer; /* skips token */
@@ -98,11 +101,12 @@ skip(struct utils_s *utils)
         skip_string(utils);
         return;
     default:
+     {
         /* skip tokens while not end of string or not new key */
-        while ('\0' != *utils->buffer && ',' != *utils->buffer){
-            ++utils->buffer;
-        }
+        char *next = memchr(utils->buffer, ',', utils->end - utils->buffer);
+        utils->buffer = (NULL != next) ? next : utils->end;
         return;
+     }
     }
 }
 
@@ -247,14 +251,15 @@ apply(struct utils_s *utils, struct pair_s *pair, bool *is_nest)
     case '3': case '4': case '5': case '6':
     case '7': case '8': case '9':
      {
-        double num = Jscon_decode_double(&utils->buffer);
-        if (DOUBLE_IS_INTEGER(num)){
+        long long i_num;
+        double num;
+        if (Jscon_decode_number(&utils->buffer, &i_num, &num)){
             if (STREQ(pair->specifier, "d")){
-                *(int *)pair->value = (int)num;
+                *(int *)pair->value = (int)i_num;
             } else if (STREQ(pair->specifier, "ld")){
-                *(long *)pair->value = (long)num;
+                *(long *)pair->value = (long)i_num;
             } else if (STREQ(pair->specifier, "lld")){
-                *(long long *)pair->value = (long long)num;
+                *(long long *)pair->value = i_num;
             } else {
                 strscpy(err_typeis, "short*, int*, long*, long long* or jscon_item_t**", sizeof(err_typeis));
                 goto type_error;
@@ -444,16 +449,9 @@ format_decode(char *format, struct pair_s **pairs, int *num_pairs, va_list *ap)
     }
 }
 
-/* works like sscanf, will parse stuff only for the keys specified to the format string parameter.
- *  the variables assigned to ... must be in
- *  the correct order, and type, as the requested keys.  
- *
- * every key found that doesn't match any of the requested keys will be ignored along with all of 
- *  its contents. */
-void
-jscon_scanf(char *buffer, char *format, ...)
+static void
+_jscon_vscanf(char *buffer, char *end, char *format, va_list *ap)
 {
-    ASSERT_S(buffer != NULL, jscon_strerror(JSCON_EXT__EMPTY_FIELD, buffer));
     ASSERT_S(format != NULL, jscon_strerror(JSCON_EXT__EMPTY_FIELD, format));
 
     CONSUME_BLANK_CHARS(buffer);
@@ -461,11 +459,10 @@ jscon_scanf(char *buffer, char *format, ...)
 
     struct utils_s utils = {
         .key     = "",
-        .buffer  = buffer
+        .buffer  = buffer,
+        .end     = end
     };
 
-    va_list ap;
-    va_start(ap, format);
 
     int num_keys = 0;
     format_analyze(format, &num_keys);
@@ -475,11 +472,11 @@ jscon_scanf(char *buffer, char *format, ...)
     struct pair_s **pairs = malloc(num_keys * sizeof *pairs);
     ASSERT_S(NULL != pairs, jscon_strerror(JSCON_EXT__OUT_MEM, pairs));
 
-    format_decode(format, pairs, &num_pairs, &ap);
+    format_decode(format, pairs, &num_pairs, ap);
     ASSERT_S(num_keys == num_pairs, "Number of keys encountered is different than allocated");
 
     bool is_nest = false; /* condition to form nested keys */
-    while (*utils.buffer != '\0')
+    while (utils.buffer < utils.end && *utils.buffer != '\0')
     {
         if ('\"' == *utils.buffer)
         {
@@ -521,13 +518,12 @@ jscon_scanf(char *buffer, char *format, ...)
             }
         }
         else {
-            /* not a key token, skip it */
-            ++utils.buffer;
+            /* not a key token, jump to the next string */
+            char *next = memchr(utils.buffer + 1, '\"', utils.end - (utils.buffer + 1));
+            utils.buffer = (NULL != next) ? next : utils.end;
         }
     }
 
-    va_end(ap);
-
     /* clean resources */
     for (int i=0; i < num_pairs; ++i){
         free(pairs[i]->key);
@@ -536,3 +532,43 @@ jscon_scanf(char *buffer, char *format, ...)
     free(pairs);
 
 }
+
+/* works like sscanf, will parse stuff only for the keys specified to the format string parameter.
+ *  the variables assigned to ... must be in
+ *  the correct order, and type, as the requested keys.  
+ *
+ * every key found that doesn't match any of the requested keys will be ignored along with all of 
+ *  its contents. */
+void
+jscon_scanf(char *buffer, char *format, ...)
+{
+    ASSERT_S(buffer != NULL, jscon_strerror(JSCON_EXT__EMPTY_FIELD, buffer));
+
+    va_list ap;
+    va_start(ap, format);
+
+    _jscon_vscanf(buffer, buffer + strlen(buffer), format, &ap);
+
+    va_end(ap);
+}
+
+/* same as jscon_scanf(), but for a buffer of len bytes which doesn't
+ *  need to be NUL terminated. buffer is validated first, so that no
+ *  token can extend past its end */
+void
+jscon_scanf_len(const char *buffer, size_t len, char *format, ...)
+{
+    ASSERT_S(buffer != NULL, "Missing JSON text buffer");
+
+    long err_offset = jscon_validate(buffer, len);
+    if (-1 != err_offset){
+        ERROR("Invalid JSON text at offset %ld", err_offset);
+    }
+
+    va_list ap;
+    va_start(ap, format);
+
+    _jscon_vscanf((char*)buffer, (char*)buffer + len, format, &ap);
+
+    va_end(ap);
+}
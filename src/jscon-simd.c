@@ -0,0 +1,412 @@
+/*
+ * Copyright (c) 2020 Lucas Müller
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Vectorized scanning routines, they let the parser and jscon_scanf()
+ *  jump between tokens instead of branching on every byte. The best
+ *  implementation available (AVX2, SSE2 or scalar) is picked once, at
+ *  load time.
+ *
+ * Input is NUL terminated, so vector loads are aligned to the vector
+ *  width: an aligned load never crosses a page boundary, which makes it
+ *  safe to read past the terminator within the last block. Bounded
+ *  routines only load full vectors, and finish with the scalar ones. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <libjscon.h>
+#include "jscon-common.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#  define JSCON_SIMD_X86 1
+#  include <immintrin.h>
+#else
+#  define JSCON_SIMD_X86 0
+#endif
+
+#if defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5)
+#  define NO_SANITIZE_ADDRESS __attribute__((no_sanitize_address))
+#else
+#  define NO_SANITIZE_ADDRESS
+#endif
+
+
+static char*
+_jscon_find_token_scalar(const char *str, char c1, char c2, char c3)
+{
+    while ('\0' != *str && c1 != *str && c2 != *str && c3 != *str){
+        ++str;
+    }
+    return (char*)str;
+}
+
+static char*
+_jscon_find_plain_end_scalar(const char *str)
+{
+    while ('\0' != *str && '\"' != *str && '\\' != *str && (signed char)*str >= 0){
+        ++str;
+    }
+    return (char*)str;
+}
+
+static char*
+_jscon_skip_blank_scalar(const char *str)
+{
+    while (IS_BLANK_CHAR(*str)){
+        ++str;
+    }
+    return (char*)str;
+}
+
+/* signed compare, bytes past ASCII are negative */
+#define IS_PLAIN_CHAR(c) ('\"' != (c) && '\\' != (c) && (signed char)(c) >= 0x20)
+
+static char*
+_jscon_find_escape_scalar(const char *str, const char *end)
+{
+    while (str < end && IS_PLAIN_CHAR(*str)){
+        ++str;
+    }
+    return (char*)str;
+}
+
+static size_t
+_jscon_copy_plain_scalar(char *dest, const char *src, const char *end)
+{
+    const char *start = src;
+    while (src < end && IS_PLAIN_CHAR(*src)){
+        *dest++ = *src++;
+    }
+    return src - start;
+}
+
+#if JSCON_SIMD_X86
+
+/* blank chars are the control chars and space (1 to 32), and DEL (127) */
+#define SSE2_BLANK_MASK(v) \
+    _mm_or_si128( \
+        _mm_cmpeq_epi8(_mm_min_epu8(_mm_sub_epi8(v, _mm_set1_epi8(1)), _mm_set1_epi8(31)), \
+                       _mm_sub_epi8(v, _mm_set1_epi8(1))), \
+        _mm_cmpeq_epi8(v, _mm_set1_epi8(127)))
+
+#define SSE2_TOKEN_MASK(v, s1, s2, s3) \
+    _mm_or_si128( \
+        _mm_or_si128(_mm_cmpeq_epi8(v, s1), _mm_cmpeq_epi8(v, s2)), \
+        _mm_or_si128(_mm_cmpeq_epi8(v, s3), _mm_cmpeq_epi8(v, _mm_setzero_si128())))
+
+__attribute__((target("sse2"))) NO_SANITIZE_ADDRESS
+static char*
+_jscon_find_token_sse2(const char *str, char c1, char c2, char c3)
+{
+    const __m128i s1 = _mm_set1_epi8(c1);
+    const __m128i s2 = _mm_set1_epi8(c2);
+    const __m128i s3 = _mm_set1_epi8(c3);
+
+    /* first block is aligned down, ignore matches before str */
+    size_t misalign = (uintptr_t)str & 15;
+    const __m128i *block = (const __m128i*)(str - misalign);
+
+    __m128i v = _mm_load_si128(block);
+    unsigned mask = (unsigned)_mm_movemask_epi8(SSE2_TOKEN_MASK(v, s1, s2, s3)) >> misalign;
+    if (mask) return (char*)str + __builtin_ctz(mask);
+
+    while (1){
+        v = _mm_load_si128(++block);
+        mask = _mm_movemask_epi8(SSE2_TOKEN_MASK(v, s1, s2, s3));
+        if (mask) return (char*)block + __builtin_ctz(mask);
+    }
+}
+
+/* double quotes, backslash or NUL terminator, non-ASCII chars are
+ *  found by their sign bit alone */
+#define SSE2_PLAIN_END_MASK(v) \
+    ((unsigned)_mm_movemask_epi8(_mm_or_si128( \
+        _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\"')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\\'))), \
+        _mm_cmpeq_epi8(v, _mm_setzero_si128()))) \
+     | (unsigned)_mm_movemask_epi8(v))
+
+__attribute__((target("sse2"))) NO_SANITIZE_ADDRESS
+static char*
+_jscon_find_plain_end_sse2(const char *str)
+{
+    size_t misalign = (uintptr_t)str & 15;
+    const __m128i *block = (const __m128i*)(str - misalign);
+
+    __m128i v = _mm_load_si128(block);
+    unsigned mask = SSE2_PLAIN_END_MASK(v) >> misalign;
+    if (mask) return (char*)str + __builtin_ctz(mask);
+
+    while (1){
+        v = _mm_load_si128(++block);
+        mask = SSE2_PLAIN_END_MASK(v);
+        if (mask) return (char*)block + __builtin_ctz(mask);
+    }
+}
+
+/* double quotes, backslash, control chars (0 to 31) or non-ASCII
+ *  (128 to 255), the last two being below 32 if signed */
+#define SSE2_ESCAPE_MASK(v) \
+    _mm_or_si128( \
+        _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\"')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\\'))), \
+        _mm_cmplt_epi8(v, _mm_set1_epi8(0x20)))
+
+/* bounded by end, only full vectors are loaded */
+__attribute__((target("sse2")))
+static char*
+_jscon_find_escape_sse2(const char *str, const char *end)
+{
+    while (end - str >= 16){
+        __m128i v = _mm_loadu_si128((const __m128i*)str);
+        unsigned mask = (unsigned)_mm_movemask_epi8(SSE2_ESCAPE_MASK(v));
+        if (mask) return (char*)str + __builtin_ctz(mask);
+        str += 16;
+    }
+    return _jscon_find_escape_scalar(str, end);
+}
+
+/* plain runs are stored a vector at a time, the bytes that precede a
+ *  special char are copied separately as dest may overlap src */
+__attribute__((target("sse2")))
+static size_t
+_jscon_copy_plain_sse2(char *dest, const char *src, const char *end)
+{
+    const char *start = src;
+    while (end - src >= 16){
+        __m128i v = _mm_loadu_si128((const __m128i*)src);
+        unsigned mask = (unsigned)_mm_movemask_epi8(SSE2_ESCAPE_MASK(v));
+        if (mask){
+            size_t n = __builtin_ctz(mask);
+            memmove(dest, src, n);
+            return (src - start) + n;
+        }
+        _mm_storeu_si128((__m128i*)dest, v);
+        src += 16;
+        dest += 16;
+    }
+    return (src - start) + _jscon_copy_plain_scalar(dest, src, end);
+}
+
+__attribute__((target("sse2"))) NO_SANITIZE_ADDRESS
+static char*
+_jscon_skip_blank_sse2(const char *str)
+{
+    size_t misalign = (uintptr_t)str & 15;
+    const __m128i *block = (const __m128i*)(str - misalign);
+
+    __m128i v = _mm_load_si128(block);
+    unsigned mask = ~(unsigned)_mm_movemask_epi8(SSE2_BLANK_MASK(v)) & 0xFFFF;
+    mask >>= misalign;
+    if (mask) return (char*)str + __builtin_ctz(mask);
+
+    while (1){
+        v = _mm_load_si128(++block);
+        mask = ~(unsigned)_mm_movemask_epi8(SSE2_BLANK_MASK(v)) & 0xFFFF;
+        if (mask) return (char*)block + __builtin_ctz(mask);
+    }
+}
+
+#define AVX2_BLANK_MASK(v) \
+    _mm256_or_si256( \
+        _mm256_cmpeq_epi8(_mm256_min_epu8(_mm256_sub_epi8(v, _mm256_set1_epi8(1)), _mm256_set1_epi8(31)), \
+                          _mm256_sub_epi8(v, _mm256_set1_epi8(1))), \
+        _mm256_cmpeq_epi8(v, _mm256_set1_epi8(127)))
+
+#define AVX2_TOKEN_MASK(v, s1, s2, s3) \
+    _mm256_or_si256( \
+        _mm256_or_si256(_mm256_cmpeq_epi8(v, s1), _mm256_cmpeq_epi8(v, s2)), \
+        _mm256_or_si256(_mm256_cmpeq_epi8(v, s3), _mm256_cmpeq_epi8(v, _mm256_setzero_si256())))
+
+__attribute__((target("avx2"))) NO_SANITIZE_ADDRESS
+static char*
+_jscon_find_token_avx2(const char *str, char c1, char c2, char c3)
+{
+    const __m256i s1 = _mm256_set1_epi8(c1);
+    const __m256i s2 = _mm256_set1_epi8(c2);
+    const __m256i s3 = _mm256_set1_epi8(c3);
+
+    size_t misalign = (uintptr_t)str & 31;
+    const __m256i *block = (const __m256i*)(str - misalign);
+
+    __m256i v = _mm256_load_si256(block);
+    uint32_t mask = (uint32_t)_mm256_movemask_epi8(AVX2_TOKEN_MASK(v, s1, s2, s3)) >> misalign;
+    if (mask) return (char*)str + __builtin_ctz(mask);
+
+    while (1){
+        v = _mm256_load_si256(++block);
+        mask = (uint32_t)_mm256_movemask_epi8(AVX2_TOKEN_MASK(v, s1, s2, s3));
+        if (mask) return (char*)block + __builtin_ctz(mask);
+    }
+}
+
+#define AVX2_PLAIN_END_MASK(v) \
+    ((uint32_t)_mm256_movemask_epi8(_mm256_or_si256( \
+        _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\"')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\'))), \
+        _mm256_cmpeq_epi8(v, _mm256_setzero_si256()))) \
+     | (uint32_t)_mm256_movemask_epi8(v))
+
+__attribute__((target("avx2"))) NO_SANITIZE_ADDRESS
+static char*
+_jscon_find_plain_end_avx2(const char *str)
+{
+    size_t misalign = (uintptr_t)str & 31;
+    const __m256i *block = (const __m256i*)(str - misalign);
+
+    __m256i v = _mm256_load_si256(block);
+    uint32_t mask = AVX2_PLAIN_END_MASK(v) >> misalign;
+    if (mask) return (char*)str + __builtin_ctz(mask);
+
+    while (1){
+        v = _mm256_load_si256(++block);
+        mask = AVX2_PLAIN_END_MASK(v);
+        if (mask) return (char*)block + __builtin_ctz(mask);
+    }
+}
+
+#define AVX2_ESCAPE_MASK(v) \
+    _mm256_or_si256( \
+        _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\"')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\'))), \
+        _mm256_cmpgt_epi8(_mm256_set1_epi8(0x20), v))
+
+__attribute__((target("avx2")))
+static char*
+_jscon_find_escape_avx2(const char *str, const char *end)
+{
+    while (end - str >= 32){
+        __m256i v = _mm256_loadu_si256((const __m256i*)str);
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(AVX2_ESCAPE_MASK(v));
+        if (mask) return (char*)str + __builtin_ctz(mask);
+        str += 32;
+    }
+    return _jscon_find_escape_sse2(str, end);
+}
+
+__attribute__((target("avx2")))
+static size_t
+_jscon_copy_plain_avx2(char *dest, const char *src, const char *end)
+{
+    const char *start = src;
+    while (end - src >= 32){
+        __m256i v = _mm256_loadu_si256((const __m256i*)src);
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(AVX2_ESCAPE_MASK(v));
+        if (mask){
+            size_t n = __builtin_ctz(mask);
+            memmove(dest, src, n);
+            return (src - start) + n;
+        }
+        _mm256_storeu_si256((__m256i*)dest, v);
+        src += 32;
+        dest += 32;
+    }
+    return (src - start) + _jscon_copy_plain_sse2(dest, src, end);
+}
+
+__attribute__((target("avx2"))) NO_SANITIZE_ADDRESS
+static char*
+_jscon_skip_blank_avx2(const char *str)
+{
+    size_t misalign = (uintptr_t)str & 31;
+    const __m256i *block = (const __m256i*)(str - misalign);
+
+    __m256i v = _mm256_load_si256(block);
+    uint32_t mask = ~(uint32_t)_mm256_movemask_epi8(AVX2_BLANK_MASK(v));
+    mask >>= misalign;
+    if (mask) return (char*)str + __builtin_ctz(mask);
+
+    while (1){
+        v = _mm256_load_si256(++block);
+        mask = ~(uint32_t)_mm256_movemask_epi8(AVX2_BLANK_MASK(v));
+        if (mask) return (char*)block + __builtin_ctz(mask);
+    }
+}
+
+#endif /* JSCON_SIMD_X86 */
+
+
+static char* (*_jscon_find_token_impl)(const char*, char, char, char) = &_jscon_find_token_scalar;
+static char* (*_jscon_skip_blank_impl)(const char*) = &_jscon_skip_blank_scalar;
+static char* (*_jscon_find_plain_end_impl)(const char*) = &_jscon_find_plain_end_scalar;
+static char* (*_jscon_find_escape_impl)(const char*, const char*) = &_jscon_find_escape_scalar;
+static size_t (*_jscon_copy_plain_impl)(char*, const char*, const char*) = &_jscon_copy_plain_scalar;
+
+/* runtime dispatch, pick the widest instruction set supported */
+__attribute__((constructor))
+static void
+_jscon_simd_init(void)
+{
+#if JSCON_SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")){
+        _jscon_find_token_impl = &_jscon_find_token_avx2;
+        _jscon_skip_blank_impl = &_jscon_skip_blank_avx2;
+        _jscon_find_plain_end_impl = &_jscon_find_plain_end_avx2;
+        _jscon_find_escape_impl = &_jscon_find_escape_avx2;
+        _jscon_copy_plain_impl = &_jscon_copy_plain_avx2;
+    } else if (__builtin_cpu_supports("sse2")){
+        _jscon_find_token_impl = &_jscon_find_token_sse2;
+        _jscon_skip_blank_impl = &_jscon_skip_blank_sse2;
+        _jscon_find_plain_end_impl = &_jscon_find_plain_end_sse2;
+        _jscon_find_escape_impl = &_jscon_find_escape_sse2;
+        _jscon_copy_plain_impl = &_jscon_copy_plain_sse2;
+    }
+#endif
+}
+
+/* return address of the first c1, c2, c3 or NUL terminator found */
+char*
+Jscon_find_token(const char *str, char c1, char c2, char c3){
+    return (*_jscon_find_token_impl)(str, c1, c2, c3);
+}
+
+/* return address of the first non-blank char */
+char*
+Jscon_skip_blank(const char *str)
+{
+    /* most tokens aren't preceded by blank chars, or only by a few */
+    if (!IS_BLANK_CHAR(*str)) return (char*)str;
+    if (!IS_BLANK_CHAR(str[1])) return (char*)str + 1;
+
+    return (*_jscon_skip_blank_impl)(str + 1);
+}
+
+/* return address of the first double quotes, backslash, non-ASCII char
+ *  or NUL terminator found, a string is plain if it ends at the former */
+char*
+Jscon_find_plain_end(const char *str){
+    return (*_jscon_find_plain_end_impl)(str);
+}
+
+/* return address of the first double quotes, backslash, control or
+ *  non-ASCII char found within [str,end), or end if there is none */
+char*
+Jscon_find_escape(const char *str, const char *end){
+    return (*_jscon_find_escape_impl)(str, end);
+}
+
+/* copy the chars of [src,end) that come before the first one
+ *  Jscon_find_escape() would stop at into dest, and return how many.
+ *  dest may overlap src as long as it doesn't come after it */
+size_t
+Jscon_copy_plain(char *dest, const char *src, const char *end){
+    return (*_jscon_copy_plain_impl)(dest, src, end);
+}
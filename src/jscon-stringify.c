@@ -71,6 +71,38 @@ _jscon_utils_apply_string(char *string, struct _jscon_utils_s *utils)
     }
 }
 
+/* get string value escaped as a JSON string's contents to perform
+    buffer method calls, UTF-8 chars are kept as they are */
+static void
+_jscon_utils_apply_escaped(char *string, struct _jscon_utils_s *utils)
+{
+    static const char hex_digits[] = "0123456789abcdef";
+
+    while ('\0' != *string){
+        unsigned char c = *string++;
+        if ('\"' != c && '\\' != c && c >= 0x20){
+            (*utils->method)(c, utils);
+            continue;
+        }
+
+        (*utils->method)('\\', utils);
+        switch (c){
+        case '\"': (*utils->method)('\"', utils); break;
+        case '\\': (*utils->method)('\\', utils); break;
+        case '\b': (*utils->method)('b', utils); break;
+        case '\f': (*utils->method)('f', utils); break;
+        case '\n': (*utils->method)('n', utils); break;
+        case '\r': (*utils->method)('r', utils); break;
+        case '\t': (*utils->method)('t', utils); break;
+        default:
+            _jscon_utils_apply_string("u00", utils);
+            (*utils->method)(hex_digits[c >> 4], utils);
+            (*utils->method)(hex_digits[c & 0xF], utils);
+            break;
+        }
+    }
+}
+
 /* converts double to string and store it in p_str */
 static void 
 _jscon_double_tostr(const double d_number, char *p_str)
@@ -85,33 +117,21 @@ _jscon_double_tostr(const double d_number, char *p_str)
 
     if (isfinite(d_number))
     {
-        char *p_last;
-        char *tmp;
-
-        if ('0' == p_str[strlen(p_str)-1]){ /* 00 terminating exp */
-            p_last = &p_str[strlen(p_str)-1]; /* address of last digit, including exp */
-            tmp = p_last;
-
-            while ('0' == *tmp) /* trim trailing zeroes */
-                --tmp;
-
-            /* trim exp related characters */
-            if ('+' == *tmp || '-' == *tmp)
-                --tmp;
-            if ('e' == *tmp || 'E' == *tmp)
-                --tmp;
-        } else { /* get address of last significand digit */
-            p_last = (d_number < 0)
-                        ? &p_str[DBL_DECIMAL_DIG+1] /* account for minus sign */
-                        : &p_str[DBL_DECIMAL_DIG];
-            tmp = p_last;
-        }
+        char *p_exp = strchr(p_str, 'e'); /* address of exponent */
+        char *tmp = p_exp - 1; /* address of last significand digit */
 
         while ('0' == *tmp){ /* trim trailing zeroes */
             --tmp;
         }
+        if ('.' == *tmp){ /* trim dangling decimal point */
+            --tmp;
+        }
 
-        memmove(tmp+1, p_last+1, strlen(p_last+1)+1);
+        if (STREQ(p_exp, "e+00")){ /* trim null exponent */
+            tmp[1] = '\0';
+        } else {
+            memmove(tmp+1, p_exp, strlen(p_exp)+1);
+        }
     }
 }
 
@@ -131,8 +151,8 @@ _jscon_utils_apply_double(double d_number, struct _jscon_utils_s *utils)
 static void
 _jscon_utils_apply_integer(long long i_number, struct _jscon_utils_s *utils)
 {
-    char get_strnum[MAX_INTEGER_DIG];
-    snprintf(get_strnum, MAX_INTEGER_DIG-1, "%lld", i_number);
+    char get_strnum[MAX_INTEGER_DIG+2]; /* sign + digits + \0 */
+    snprintf(get_strnum, sizeof(get_strnum), "%lld", i_number);
 
     _jscon_utils_apply_string(get_strnum,utils); /* store value in utils */
 }
@@ -151,7 +171,7 @@ _jscon_stringify_preorder(jscon_item_t *item, enum jscon_type type, struct _jsco
         (array's numerical keys printing doesn't conform to standard)*/
     if (!IS_ROOT(item) && IS_PROPERTY(item)){
         (*utils->method)('\"', utils);
-        _jscon_utils_apply_string(item->key, utils);
+        _jscon_utils_apply_escaped(item->key, utils);
         (*utils->method)('\"', utils);
         (*utils->method)(':', utils);
     }
@@ -176,7 +196,7 @@ _jscon_stringify_preorder(jscon_item_t *item, enum jscon_type type, struct _jsco
         break;
     case JSCON_STRING:
         (*utils->method)('\"', utils);
-        _jscon_utils_apply_string(item->string, utils);
+        _jscon_utils_apply_escaped(item->string, utils);
         (*utils->method)('\"', utils);
         break;
     case JSCON_OBJECT:
@@ -0,0 +1,457 @@
+/*
+ * Copyright (c) 2020 Lucas Müller
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* JSCON TAPE
+ *  compact, read-only document representation. values are laid out in
+ *  document order over a contiguous tape of 64-bit words, whose top 8
+ *  bits tag what the word holds, and the remaining 56 bits its payload:
+ *      '{' '[': composite start, payload is the tape index past its end
+ *      '}' ']': composite end, payload is its amount of branches
+ *      'K': property key, its value follows. payload is the key's
+ *          offset at the string buffer
+ *      '"': string, payload is its offset at the string buffer
+ *      'l' 'd': integer or double, the next word holds its raw bits
+ *      't' 'f' 'n': true, false and null, no payload
+ *  the string buffer holds every (decoded) key and string, each one
+ *  prefixed by its 32-bit length and NUL terminated.
+ *  a tape is built from the events of jscon_parse_sax(), so no
+ *  jscon_item_t is ever created */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <libjscon.h>
+#include "jscon-common.h"
+
+#include "debug.h"
+
+
+#define TAPE_TAG(word) ((char)((word) >> 56))
+#define TAPE_PAYLOAD(word) ((word) & (((uint64_t)1 << 56) - 1))
+#define TAPE_WORD(tag, payload) (((uint64_t)(unsigned char)(tag) << 56) | (uint64_t)(payload))
+
+struct jscon_tape_s {
+    uint64_t *word;
+    size_t num_word;
+    size_t cap_word;
+
+    char *string; /* string buffer */
+    size_t len_string;
+    size_t cap_string;
+};
+
+/* state kept while the tape is built */
+struct _jscon_tape_builder_s {
+    jscon_tape_t *tape;
+
+    size_t *start; /* tape index of each open composite's start */
+    size_t *num_branch; /* amount of branches of each open composite */
+    size_t depth;
+    size_t cap_depth;
+};
+
+static void
+_jscon_tape_push(jscon_tape_t *tape, uint64_t word)
+{
+    if (tape->num_word == tape->cap_word){
+        tape->cap_word = (0 == tape->cap_word) ? 64 : 2 * tape->cap_word;
+        tape->word = realloc(tape->word, tape->cap_word * sizeof(uint64_t));
+        ASSERT_S(NULL != tape->word, jscon_strerror(JSCON_EXT__OUT_MEM, tape->word));
+    }
+    tape->word[tape->num_word++] = word;
+}
+
+/* decode string into the string buffer, and return its offset */
+static size_t
+_jscon_tape_push_string(jscon_tape_t *tape, const char *string, size_t len)
+{
+    size_t needed = tape->len_string + sizeof(uint32_t) + len + 1;
+    if (needed > tape->cap_string){
+        tape->cap_string = (needed > 2 * tape->cap_string) ? needed : 2 * tape->cap_string;
+        tape->string = realloc(tape->string, tape->cap_string);
+        ASSERT_S(NULL != tape->string, jscon_strerror(JSCON_EXT__OUT_MEM, tape->string));
+    }
+
+    size_t offset = tape->len_string;
+    /* decoding never grows a string */
+    uint32_t decoded_len = Jscon_unescape_string(tape->string + offset + sizeof(uint32_t), string, len);
+    memcpy(tape->string + offset, &decoded_len, sizeof(uint32_t));
+
+    tape->len_string += sizeof(uint32_t) + decoded_len + 1;
+
+    return offset;
+}
+
+/* a new value is a branch of the innermost open composite */
+static void
+_jscon_tape_count_value(struct _jscon_tape_builder_s *builder)
+{
+    if (0 != builder->depth){
+        ++builder->num_branch[builder->depth-1];
+    }
+}
+
+static void
+_jscon_tape_start(struct _jscon_tape_builder_s *builder, char tag)
+{
+    _jscon_tape_count_value(builder);
+
+    if (builder->depth == builder->cap_depth){
+        builder->cap_depth = (0 == builder->cap_depth) ? 32 : 2 * builder->cap_depth;
+        builder->start = realloc(builder->start, builder->cap_depth * sizeof(size_t));
+        builder->num_branch = realloc(builder->num_branch, builder->cap_depth * sizeof(size_t));
+        ASSERT_S(NULL != builder->start && NULL != builder->num_branch, jscon_strerror(JSCON_EXT__OUT_MEM, builder->start));
+    }
+
+    builder->start[builder->depth] = builder->tape->num_word;
+    builder->num_branch[builder->depth] = 0;
+    ++builder->depth;
+
+    _jscon_tape_push(builder->tape, TAPE_WORD(tag, 0)); /* patched at its end */
+}
+
+static void
+_jscon_tape_end(struct _jscon_tape_builder_s *builder, char tag)
+{
+    jscon_tape_t *tape = builder->tape;
+
+    --builder->depth;
+    _jscon_tape_push(tape, TAPE_WORD(tag, builder->num_branch[builder->depth]));
+
+    size_t start = builder->start[builder->depth];
+    tape->word[start] = TAPE_WORD(TAPE_TAG(tape->word[start]), tape->num_word);
+}
+
+static void
+_jscon_tape_start_object(void *data){
+    _jscon_tape_start(data, '{');
+}
+
+static void
+_jscon_tape_end_object(void *data){
+    _jscon_tape_end(data, '}');
+}
+
+static void
+_jscon_tape_start_array(void *data){
+    _jscon_tape_start(data, '[');
+}
+
+static void
+_jscon_tape_end_array(void *data){
+    _jscon_tape_end(data, ']');
+}
+
+static void
+_jscon_tape_key(const char *key, size_t len, void *data)
+{
+    struct _jscon_tape_builder_s *builder = data;
+    _jscon_tape_push(builder->tape, TAPE_WORD('K', _jscon_tape_push_string(builder->tape, key, len)));
+}
+
+static void
+_jscon_tape_string(const char *string, size_t len, void *data)
+{
+    struct _jscon_tape_builder_s *builder = data;
+    _jscon_tape_count_value(builder);
+    _jscon_tape_push(builder->tape, TAPE_WORD('\"', _jscon_tape_push_string(builder->tape, string, len)));
+}
+
+static void
+_jscon_tape_number(enum jscon_type type, long long i_number, double d_number, void *data)
+{
+    struct _jscon_tape_builder_s *builder = data;
+    _jscon_tape_count_value(builder);
+
+    uint64_t bits;
+    if (JSCON_INTEGER == type){
+        _jscon_tape_push(builder->tape, TAPE_WORD('l', 0));
+        memcpy(&bits, &i_number, sizeof(bits));
+    } else {
+        _jscon_tape_push(builder->tape, TAPE_WORD('d', 0));
+        memcpy(&bits, &d_number, sizeof(bits));
+    }
+    _jscon_tape_push(builder->tape, bits);
+}
+
+static void
+_jscon_tape_boolean(bool boolean, void *data)
+{
+    struct _jscon_tape_builder_s *builder = data;
+    _jscon_tape_count_value(builder);
+    _jscon_tape_push(builder->tape, TAPE_WORD(boolean ? 't' : 'f', 0));
+}
+
+static void
+_jscon_tape_null(void *data)
+{
+    struct _jscon_tape_builder_s *builder = data;
+    _jscon_tape_count_value(builder);
+    _jscon_tape_push(builder->tape, TAPE_WORD('n', 0));
+}
+
+/* parse a buffer of len bytes which doesn't need to be NUL terminated
+    into a new tape */
+jscon_tape_t*
+jscon_tape_parse(const char *buffer, size_t len)
+{
+    ASSERT_S(NULL != buffer, "Missing JSON text buffer");
+
+    static const jscon_sax_t sax = {
+        .start_object = &_jscon_tape_start_object,
+        .end_object = &_jscon_tape_end_object,
+        .start_array = &_jscon_tape_start_array,
+        .end_array = &_jscon_tape_end_array,
+        .key = &_jscon_tape_key,
+        .string = &_jscon_tape_string,
+        .number = &_jscon_tape_number,
+        .boolean = &_jscon_tape_boolean,
+        .null = &_jscon_tape_null,
+    };
+
+    jscon_tape_t *new_tape = calloc(1, sizeof *new_tape);
+    ASSERT_S(NULL != new_tape, jscon_strerror(JSCON_EXT__OUT_MEM, new_tape));
+
+    struct _jscon_tape_builder_s builder = { .tape = new_tape };
+
+    long err_offset = jscon_parse_sax(buffer, len, &sax, &builder);
+    if (-1 != err_offset){
+        ERROR("Invalid JSON text at offset %ld", err_offset);
+    }
+
+    free(builder.start);
+    free(builder.num_branch);
+
+    /* the tape won't grow anymore */
+    new_tape->word = realloc(new_tape->word, new_tape->num_word * sizeof(uint64_t));
+    new_tape->cap_word = new_tape->num_word;
+    if (0 != new_tape->len_string){
+        new_tape->string = realloc(new_tape->string, new_tape->len_string);
+        new_tape->cap_string = new_tape->len_string;
+    }
+
+    return new_tape;
+}
+
+void
+jscon_tape_destroy(jscon_tape_t *tape)
+{
+    if (NULL == tape) return;
+
+    free(tape->word);
+    free(tape->string);
+    free(tape);
+}
+
+/* JSCON VIEW
+ *  a view refers to a value at tape->word[pos]. a property's view
+ *  refers to its key word instead, which its value follows. a view of
+ *  nothing (ex: key not found) has a NULL tape, and is of
+ *  JSCON_UNDEFINED type */
+
+static const jscon_view_t _jscon_view_none = { NULL, 0 };
+
+/* tape index of the view's value */
+static size_t
+_jscon_view_value(jscon_view_t view)
+{
+    return ('K' == TAPE_TAG(view.tape->word[view.pos])) ? view.pos + 1 : view.pos;
+}
+
+/* tape index past the value at pos */
+static size_t
+_jscon_tape_skip(const jscon_tape_t *tape, size_t pos)
+{
+    switch (TAPE_TAG(tape->word[pos])){
+    case '{': case '[':
+        return TAPE_PAYLOAD(tape->word[pos]);
+    case 'l': case 'd':
+        return pos + 2;
+    default:
+        return pos + 1;
+    }
+}
+
+static const char*
+_jscon_tape_string_at(const jscon_tape_t *tape, uint64_t word, size_t *p_len)
+{
+    const char *str = tape->string + TAPE_PAYLOAD(word);
+    if (NULL != p_len){
+        uint32_t len;
+        memcpy(&len, str, sizeof(uint32_t));
+        *p_len = len;
+    }
+    return str + sizeof(uint32_t);
+}
+
+jscon_view_t
+jscon_tape_root(const jscon_tape_t *tape)
+{
+    ASSERT_S(NULL != tape, "Missing tape");
+    return (jscon_view_t){ tape, 0 };
+}
+
+enum jscon_type
+jscon_view_get_type(jscon_view_t view)
+{
+    if (NULL == view.tape) return JSCON_UNDEFINED;
+
+    switch (TAPE_TAG(view.tape->word[_jscon_view_value(view)])){
+    case '{': return JSCON_OBJECT;
+    case '[': return JSCON_ARRAY;
+    case '\"': return JSCON_STRING;
+    case 'l': return JSCON_INTEGER;
+    case 'd': return JSCON_DOUBLE;
+    case 't': case 'f': return JSCON_BOOLEAN;
+    case 'n': return JSCON_NULL;
+    default:
+        ERROR("Unknown tape tag found\n\tCode: %c", TAPE_TAG(view.tape->word[_jscon_view_value(view)]));
+    }
+}
+
+/* the key of a property view, NULL otherwise */
+const char*
+jscon_view_get_key(jscon_view_t view)
+{
+    if (NULL == view.tape || 'K' != TAPE_TAG(view.tape->word[view.pos])) return NULL;
+    return _jscon_tape_string_at(view.tape, view.tape->word[view.pos], NULL);
+}
+
+/* amount of branches of a composite, 0 otherwise */
+size_t
+jscon_view_size(jscon_view_t view)
+{
+    if (!(jscon_view_get_type(view) & (JSCON_OBJECT|JSCON_ARRAY))) return 0;
+
+    size_t end = TAPE_PAYLOAD(view.tape->word[_jscon_view_value(view)]) - 1;
+    return TAPE_PAYLOAD(view.tape->word[end]);
+}
+
+/* the composite's first branch, or a view of nothing if empty */
+jscon_view_t
+jscon_view_first(jscon_view_t view)
+{
+    if (!(jscon_view_get_type(view) & (JSCON_OBJECT|JSCON_ARRAY))) return _jscon_view_none;
+
+    size_t pos = _jscon_view_value(view) + 1;
+    char tag = TAPE_TAG(view.tape->word[pos]);
+    if ('}' == tag || ']' == tag) return _jscon_view_none;
+
+    return (jscon_view_t){ view.tape, pos };
+}
+
+/* the branch that follows view within its composite, or a view of
+    nothing if its the last one */
+jscon_view_t
+jscon_view_next(jscon_view_t view)
+{
+    if (NULL == view.tape || 0 == view.pos) return _jscon_view_none; /* root */
+
+    size_t pos = _jscon_tape_skip(view.tape, _jscon_view_value(view));
+    char tag = TAPE_TAG(view.tape->word[pos]);
+    if ('}' == tag || ']' == tag) return _jscon_view_none;
+
+    return (jscon_view_t){ view.tape, pos };
+}
+
+/* get object branch with given key, by scanning its keys */
+jscon_view_t
+jscon_view_get_branch(jscon_view_t view, const char *key)
+{
+    if (NULL == key || JSCON_OBJECT != jscon_view_get_type(view)) return _jscon_view_none;
+
+    size_t key_len = strlen(key);
+    for (jscon_view_t branch = jscon_view_first(view); NULL != branch.tape; branch = jscon_view_next(branch)){
+        size_t len;
+        const char *branch_key = _jscon_tape_string_at(view.tape, view.tape->word[branch.pos], &len);
+        if (len == key_len && 0 == memcmp(branch_key, key, len)){
+            return branch;
+        }
+    }
+
+    return _jscon_view_none;
+}
+
+jscon_view_t
+jscon_view_get_byindex(jscon_view_t view, size_t index)
+{
+    jscon_view_t branch = jscon_view_first(view);
+    while (NULL != branch.tape && index--){
+        branch = jscon_view_next(branch);
+    }
+    return branch;
+}
+
+bool
+jscon_view_get_boolean(jscon_view_t view)
+{
+    if (NULL == view.tape) return false;
+
+    uint64_t word = view.tape->word[_jscon_view_value(view)];
+    if ('n' == TAPE_TAG(word)) return false;
+
+    ASSERT_S('t' == TAPE_TAG(word) || 'f' == TAPE_TAG(word), "Not a boolean");
+    return ('t' == TAPE_TAG(word));
+}
+
+/* the string's length is stored at p_len, if given */
+const char*
+jscon_view_get_string(jscon_view_t view, size_t *p_len)
+{
+    if (NULL == view.tape) return NULL;
+
+    uint64_t word = view.tape->word[_jscon_view_value(view)];
+    if ('n' == TAPE_TAG(word)) return NULL;
+
+    ASSERT_S('\"' == TAPE_TAG(word), "Not a string");
+    return _jscon_tape_string_at(view.tape, word, p_len);
+}
+
+double
+jscon_view_get_double(jscon_view_t view)
+{
+    if (NULL == view.tape) return 0.0;
+
+    size_t pos = _jscon_view_value(view);
+    if ('n' == TAPE_TAG(view.tape->word[pos])) return 0.0;
+
+    ASSERT_S('d' == TAPE_TAG(view.tape->word[pos]), "Not a double");
+    double d_number;
+    memcpy(&d_number, &view.tape->word[pos+1], sizeof(double));
+    return d_number;
+}
+
+long long
+jscon_view_get_integer(jscon_view_t view)
+{
+    if (NULL == view.tape) return 0;
+
+    size_t pos = _jscon_view_value(view);
+    if ('n' == TAPE_TAG(view.tape->word[pos])) return 0;
+
+    ASSERT_S('l' == TAPE_TAG(view.tape->word[pos]), "Not an integer");
+    long long i_number;
+    memcpy(&i_number, &view.tape->word[pos+1], sizeof(long long));
+    return i_number;
+}
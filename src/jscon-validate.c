@@ -0,0 +1,342 @@
+/*
+ * Copyright (c) 2020 Lucas Müller
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Validation only mode, checks a JSON text against RFC 8259 (strings
+ *  must be well-formed UTF-8) without building any item or allocating
+ *  any memory. Nesting is tracked in a fixed size bit stack (one bit
+ *  per level, set for objects).
+ * The same tokenizer drives the event (SAX) mode of jscon_parse_sax(),
+ *  which reports each token to user callbacks as it's validated, so
+ *  memory use doesn't grow with the input. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <libjscon.h>
+#include "jscon-common.h"
+#include "debug.h"
+
+#define IS_DIGIT(c) ((unsigned)((unsigned char)(c) - '0') < 10u)
+#define IS_HEX_DIGIT(c) \
+    (IS_DIGIT(c) || (unsigned)(((unsigned char)(c) | 0x20) - 'a') < 6u)
+/* only the four whitespace chars allowed by the JSON grammar */
+#define IS_JSON_BLANK(c) (' ' == (c) || '\n' == (c) || '\r' == (c) || '\t' == (c))
+
+static inline const char*
+_jscon_validate_blank(const char *str, const char *end)
+{
+    while (str < end && IS_JSON_BLANK(*str)){
+        ++str;
+    }
+    return str;
+}
+
+/* each of the following advance *p_str past the token, or up to the
+ *  offending char and return false */
+
+static bool
+_jscon_validate_string(const char **p_str, const char *end)
+{
+    const char *str = *p_str + 1; /* skips double quotes */
+    while (1){
+        str = Jscon_find_escape(str, end);
+        if (str == end) break; /* unterminated string */
+        if ((signed char)*str < 0){ /* non-ASCII, must be UTF-8 */
+            size_t n = Jscon_utf8_length(str, end);
+            if (0 == n) break;
+            str += n;
+            continue;
+        }
+        if ('\"' != *str && '\\' != *str) break; /* control char */
+        if ('\"' == *str){
+            *p_str = str + 1;
+            return true;
+        }
+
+        /* validate escape sequence */
+        if (++str == end) break;
+        switch (*str){
+        case '\"': case '\\': case '/': case 'b':
+        case 'f':  case 'n':  case 'r': case 't':
+            ++str;
+            continue;
+        case 'u':
+            if (end - str < 5) {
+                str = end;
+                break;
+            }
+            for (int i=1; i <= 4; ++i){
+                if (!IS_HEX_DIGIT(str[i])){
+                    str += i;
+                    goto error;
+                }
+            }
+            str += 5;
+            continue;
+        default:
+            break;
+        }
+        break;
+    }
+
+error:
+    *p_str = str;
+    return false;
+}
+
+static bool
+_jscon_validate_number(const char **p_str, const char *end)
+{
+    const char *str = *p_str;
+
+    if ('-' == *str) ++str;
+
+    /* integer part has no leading zeroes */
+    if (str == end || !IS_DIGIT(*str)) goto error;
+    if ('0' == *str++){
+        if (str < end && IS_DIGIT(*str)) goto error;
+    } else {
+        while (str < end && IS_DIGIT(*str)) ++str;
+    }
+
+    if (str < end && '.' == *str){
+        if (++str == end || !IS_DIGIT(*str)) goto error;
+        while (str < end && IS_DIGIT(*str)) ++str;
+    }
+
+    if (str < end && ('e' == *str || 'E' == *str)){
+        if (++str < end && ('+' == *str || '-' == *str)) ++str;
+        if (str == end || !IS_DIGIT(*str)) goto error;
+        while (str < end && IS_DIGIT(*str)) ++str;
+    }
+
+    *p_str = str;
+    return true;
+
+error:
+    *p_str = str;
+    return false;
+}
+
+static bool
+_jscon_validate_literal(const char **p_str, const char *end, const char literal[], size_t len)
+{
+    const char *str = *p_str;
+    for (size_t i=0; i < len; ++i, ++str){
+        if (str == end || literal[i] != *str){
+            *p_str = str;
+            return false;
+        }
+    }
+    *p_str = str;
+    return true;
+}
+
+/* decode the validated number at [start,str) for the number event,
+    the char after a number can only be read if it's within the buffer */
+static void
+_jscon_sax_number(const jscon_sax_t *sax, const char *start, const char *str, const char *end, void *data)
+{
+    long long i_number = 0;
+    double d_number = 0.0;
+    bool is_integer;
+
+    if (str < end){
+        char *tmp = (char*)start; /* only read from */
+        is_integer = Jscon_decode_number(&tmp, &i_number, &d_number);
+    } else { /* top-level number, copy it to be NUL terminated */
+        char *tmp = Jscon_strndup(NULL, start, str - start);
+        char *p_tmp = tmp;
+        is_integer = Jscon_decode_number(&p_tmp, &i_number, &d_number);
+        free(tmp);
+    }
+
+    if (is_integer){
+        (*sax->number)(JSCON_INTEGER, i_number, (double)i_number, data);
+    } else {
+        (*sax->number)(JSCON_DOUBLE, (long long)0, d_number, data);
+    }
+}
+
+/* returns -1 if buffer is valid JSON, otherwise the offset of the first
+ *  offending char (len if the text ends prematurely). each token is
+ *  reported to sax callbacks, if given, right after it's validated.
+ *  element_cb, if given, is called with the first char of each
+ *  top-level array element (the structural pass of
+ *  jscon_parse_parallel()). inlined so that each caller gets its own
+ *  copy without the checks for what it doesn't use */
+static inline __attribute__((always_inline)) long
+_jscon_validate(const char *buffer, size_t len, const jscon_sax_t *sax, void (*element_cb)(const char*, void*), void *data)
+{
+    if (NULL == buffer) return 0;
+
+    const char *str = buffer, *end = buffer + len;
+
+    uint64_t stack[MAX_NESTING_DEPTH/64];
+    size_t depth = 0;
+#define STACK_PUSH(is_object) \
+    do { \
+        if (MAX_NESTING_DEPTH == depth) goto error; \
+        if (is_object) stack[depth/64] |= (1ULL << (depth%64)); \
+        else stack[depth/64] &= ~(1ULL << (depth%64)); \
+        ++depth; \
+    } while (0)
+#define STACK_TOP_IS_OBJECT() (stack[(depth-1)/64] & (1ULL << ((depth-1)%64)))
+#define EMIT(event, ...) \
+    do { \
+        if (NULL != sax && NULL != sax->event) \
+            (*sax->event)(__VA_ARGS__); \
+    } while (0)
+
+    const char *start; /* start of the token being validated */
+
+    str = _jscon_validate_blank(str, end);
+
+value:
+    if (str == end) goto error;
+    if (NULL != element_cb && 1 == depth && !STACK_TOP_IS_OBJECT()){
+        (*element_cb)(str, data);
+    }
+    switch (*str){
+    case '{':
+        STACK_PUSH(true);
+        EMIT(start_object, data);
+        str = _jscon_validate_blank(str + 1, end);
+        if (str < end && '}' == *str){
+            ++str;
+            --depth;
+            EMIT(end_object, data);
+            goto next;
+        }
+        goto key;
+    case '[':
+        STACK_PUSH(false);
+        EMIT(start_array, data);
+        str = _jscon_validate_blank(str + 1, end);
+        if (str < end && ']' == *str){
+            ++str;
+            --depth;
+            EMIT(end_array, data);
+            goto next;
+        }
+        goto value;
+    case '\"':
+        start = str;
+        if (!_jscon_validate_string(&str, end)) goto error;
+        EMIT(string, start + 1, (size_t)(str - start - 2), data);
+        goto next;
+    case 't':
+        if (!_jscon_validate_literal(&str, end, "true", 4)) goto error;
+        EMIT(boolean, true, data);
+        goto next;
+    case 'f':
+        if (!_jscon_validate_literal(&str, end, "false", 5)) goto error;
+        EMIT(boolean, false, data);
+        goto next;
+    case 'n':
+        if (!_jscon_validate_literal(&str, end, "null", 4)) goto error;
+        EMIT(null, data);
+        goto next;
+    case '-': case '0': case '1': case '2':
+    case '3': case '4': case '5': case '6':
+    case '7': case '8': case '9':
+        start = str;
+        if (!_jscon_validate_number(&str, end)) goto error;
+        if (NULL != sax && NULL != sax->number){
+            _jscon_sax_number(sax, start, str, end, data);
+        }
+        goto next;
+    default:
+        goto error;
+    }
+
+key: /* expects a property's key string followed by ':' */
+    if (str == end || '\"' != *str) goto error;
+    start = str;
+    if (!_jscon_validate_string(&str, end)) goto error;
+    EMIT(key, start + 1, (size_t)(str - start - 2), data);
+    str = _jscon_validate_blank(str, end);
+    if (str == end || ':' != *str) goto error;
+    str = _jscon_validate_blank(str + 1, end);
+    goto value;
+
+next: /* a value has been consumed, expects a separator or wrapper */
+    str = _jscon_validate_blank(str, end);
+    if (0 == depth){
+        if (str != end) goto error; /* trailing garbage */
+        return -1;
+    }
+    if (str == end) goto error;
+
+    if (STACK_TOP_IS_OBJECT()){
+        if (',' == *str){
+            str = _jscon_validate_blank(str + 1, end);
+            goto key;
+        }
+        if ('}' == *str){
+            ++str;
+            --depth;
+            EMIT(end_object, data);
+            goto next;
+        }
+    } else {
+        if (',' == *str){
+            str = _jscon_validate_blank(str + 1, end);
+            goto value;
+        }
+        if (']' == *str){
+            ++str;
+            --depth;
+            EMIT(end_array, data);
+            goto next;
+        }
+    }
+
+error:
+    return (long)(str - buffer);
+
+#undef STACK_PUSH
+#undef STACK_TOP_IS_OBJECT
+#undef EMIT
+}
+
+long
+Jscon_validate(const char *buffer, size_t len, void (*element_cb)(const char*, void*), void *data){
+    return _jscon_validate(buffer, len, NULL, element_cb, data);
+}
+
+long
+jscon_validate(const char *buffer, size_t len){
+    return _jscon_validate(buffer, len, NULL, NULL, NULL);
+}
+
+/* report each token of buffer to the sax callbacks, no item is built,
+    returns the same as jscon_validate(), events up to the offending
+    char are delivered before an error is found */
+long
+jscon_parse_sax(const char *buffer, size_t len, const jscon_sax_t *sax, void *data)
+{
+    ASSERT_S(NULL != sax, "Missing event callbacks");
+    return _jscon_validate(buffer, len, sax, NULL, data);
+}
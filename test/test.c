@@ -27,6 +27,7 @@
 #include <unistd.h> //for access()
 #include <string.h>
 #include <locale.h>
+#include <limits.h>
 
 #include <libjscon.h>
 
@@ -34,6 +35,16 @@
 FILE *select_output(int argc, char *argv[]);
 char *get_json_text(char filename[]);
 jscon_item_t *callback_test(jscon_item_t *item);
+void count_value(void *data);
+void count_string(const char *string, size_t len, void *data);
+void count_number(enum jscon_type type, long long i_number, double d_number, void *data);
+void count_boolean(bool boolean, void *data);
+void compare_tape(jscon_item_t *item, jscon_view_t view);
+void check_record_order(jscon_item_t *root, void *data);
+bool points_into(const char *ptr, const char *buffer, size_t len);
+jscon_item_t *prune_callback(jscon_item_t *item);
+void mark_record(jscon_item_t *root, void *data);
+void check_interned_keys(jscon_item_t *root, void *data);
 
 int main(int argc, char *argv[])
 {
@@ -42,6 +53,7 @@ int main(int argc, char *argv[])
 
     FILE *f_out = select_output(argc, argv);
     char *json_text = get_json_text(argv[1]);
+    assert(-1 == jscon_validate(json_text, strlen(json_text)));
     char *buffer = NULL;
 
     jscon_item_t *item[3] = {NULL};
@@ -76,10 +88,534 @@ int main(int argc, char *argv[])
     fprintf(stdout, "t: %s\n", str1);
     fprintf(stdout, "user: %p\n", (void*)item[0]);
 
-    //jscon_parse_cb(&callback_test);
-    jscon_item_t *root = jscon_parse(json_text);
+    /* items the callback returns NULL for are left out, nested items
+     *  included, however the input is fed */
+    jscon_cb *default_cb = jscon_parse_cb(&prune_callback);
+    jscon_item_t *pruned_root[2] = {jscon_parse(json_text), NULL};
+    jscon_parser_t *prune_parser = jscon_parser_new(NULL);
+    for (size_t pos=0; pos < strlen(json_text); pos += 3){
+        jscon_parser_feed(prune_parser, json_text + pos, (strlen(json_text) - pos < 3) ? strlen(json_text) - pos : 3);
+    }
+    pruned_root[1] = jscon_parser_finish(prune_parser);
+    jscon_parse_cb(default_cb);
+    assert(default_cb == jscon_parse_cb(NULL));
+
+    char *pruned_buffer[2];
+    for (int i=0; i < 2; ++i){
+        for (jscon_item_t *it = pruned_root[i]; NULL != it; it = jscon_iter_next(it)){
+            assert(it == prune_callback(it));
+        }
+        pruned_buffer[i] = jscon_stringify(pruned_root[i], JSCON_ANY);
+        assert(NULL != pruned_buffer[i]);
+    }
+    assert(0 == strcmp(pruned_buffer[0], pruned_buffer[1]));
+    for (int i=0; i < 2; ++i){
+        free(pruned_buffer[i]);
+        jscon_destroy(pruned_root[i]);
+    }
+
+    jscon_item_t *root = jscon_parse_file(argv[1]);
     assert(NULL != root);
 
+    /* every item built has a matching value event */
+    jscon_sax_t sax = {
+        .start_object = &count_value,
+        .start_array = &count_value,
+        .string = &count_string,
+        .number = &count_number,
+        .boolean = &count_boolean,
+        .null = &count_value,
+    };
+    size_t num_value = 0, num_item = 0;
+    assert(-1 == jscon_parse_sax(json_text, strlen(json_text), &sax, &num_value));
+    for (jscon_item_t *it = root; NULL != it; it = jscon_iter_next(it)){
+        ++num_item;
+    }
+    assert(num_value == num_item);
+
+    /* external iterators walk the same as the movement functions */
+    jscon_iter_t iter;
+    jscon_iter_init(&iter, root, JSCON_ITER_ALL);
+    for (jscon_item_t *it = root; NULL != it; it = jscon_iter_next(it)){
+        assert(it == jscon_iter_step(&iter));
+    }
+    assert(NULL == jscon_iter_step(&iter));
+
+    jscon_item_t *current_comp = NULL;
+    jscon_iter_init(&iter, root, JSCON_ITER_COMPOSITE);
+    for (jscon_item_t *it = jscon_iter_composite_r(root, &current_comp); NULL != it; it = jscon_iter_composite_r(NULL, &current_comp)){
+        assert(it == jscon_iter_step(&iter));
+    }
+    assert(NULL == jscon_iter_step(&iter));
+
+    /* a walk started at a nested item stops at the end of its subtree */
+    jscon_iter_t comp_iter;
+    jscon_iter_init(&comp_iter, root, JSCON_ITER_COMPOSITE);
+    for (jscon_item_t *comp = jscon_iter_step(&comp_iter); NULL != comp; comp = jscon_iter_step(&comp_iter)){
+        jscon_iter_init(&iter, comp, JSCON_ITER_ALL);
+        for (jscon_item_t *it = comp; NULL != it; it = jscon_iter_next(it)){
+            assert(it == jscon_iter_step(&iter));
+        }
+        assert(NULL == jscon_iter_step(&iter));
+    }
+
+    jscon_iter_init(&iter, root, JSCON_ITER_BRANCH);
+    for (size_t i=0; i < jscon_size(root); ++i){
+        assert(jscon_get_byindex(root, i) == jscon_iter_step(&iter));
+    }
+    assert(NULL == jscon_iter_step(&iter));
+
+    /* the tape holds the same document */
+    jscon_tape_t *tape = jscon_tape_parse(json_text, strlen(json_text));
+    compare_tape(root, jscon_tape_root(tape));
+    jscon_tape_destroy(tape);
+
+    /* a reused document parses the same every time */
+    buffer = jscon_stringify(root, JSCON_ANY);
+    assert(NULL != buffer);
+    jscon_doc_t *doc = jscon_doc_init();
+    for (int i=0; i < 3; ++i){
+        char *doc_buffer = jscon_stringify(jscon_parse_into(doc, json_text, strlen(json_text)), JSCON_ANY);
+        assert(NULL != doc_buffer);
+        assert(0 == strcmp(buffer, doc_buffer));
+        free(doc_buffer);
+    }
+    jscon_doc_destroy(doc);
+
+    /* in-situ keys and strings point into the caller's buffer, and are
+     *  left alone by jscon_destroy() */
+    size_t insitu_len = strlen(json_text);
+    char *insitu_text = strdup(json_text);
+    assert(NULL != insitu_text);
+    jscon_item_t *insitu_root = jscon_parse_ext(insitu_text, NULL, JSCON_PARSE_INSITU);
+    for (jscon_item_t *it = insitu_root; NULL != it; it = jscon_iter_next(it)){
+        if (jscon_typecmp(it, JSCON_STRING)){
+            assert(points_into(jscon_get_string(it), insitu_text, insitu_len));
+        }
+        if (it != insitu_root && jscon_typecmp(jscon_get_parent(it), JSCON_OBJECT)){
+            assert(points_into(jscon_get_key(it), insitu_text, insitu_len));
+        }
+    }
+    char *insitu_buffer = jscon_stringify(insitu_root, JSCON_ANY);
+    assert(NULL != insitu_buffer);
+    assert(0 == strcmp(buffer, insitu_buffer));
+    free(insitu_buffer);
+    jscon_destroy(insitu_root);
+    free(insitu_text);
+
+    /* input fed in chunks of any size parses the same as a whole */
+    const size_t chunk_size[] = {1, 3, 64};
+    for (size_t i=0; i < sizeof(chunk_size)/sizeof(chunk_size[0]); ++i){
+        jscon_parser_t *parser = jscon_parser_new(NULL);
+        size_t json_len = strlen(json_text);
+        for (size_t pos=0; pos < json_len; pos += chunk_size[i]){
+            size_t len = (json_len - pos < chunk_size[i]) ? json_len - pos : chunk_size[i];
+            jscon_parser_feed(parser, json_text + pos, len);
+        }
+        jscon_item_t *fed_root = jscon_parser_finish(parser);
+        char *fed_buffer = jscon_stringify(fed_root, JSCON_ANY);
+        assert(NULL != fed_buffer);
+        assert(0 == strcmp(buffer, fed_buffer));
+        free(fed_buffer);
+        jscon_destroy(fed_root);
+    }
+
+    /* numbers decode exactly, integers that don't fit a long long
+     *  become doubles, and doubles are correctly rounded whichever
+     *  conversion path they take. properties of the fixtures that
+     *  share a key are checked alike */
+    const struct {
+        const char *key;
+        const char *text;
+        bool is_integer;
+        long long i_number;
+        double d_number;
+    } number_case[] = {
+        {"int1", "9007199254740993", true, 9007199254740993LL, 0},
+        {"int2", "9223372036854775807", true, LLONG_MAX, 0},
+        {"int3", "-9223372036854775808", true, LLONG_MIN, 0},
+        {"int4", "1234567890123456789", true, 1234567890123456789LL, 0},
+        {"int6", "-1e3", true, -1000, 0},
+        {"big1", "9223372036854775808", false, 0, 9223372036854775808.0},
+        {"big2", "1e300", false, 0, 1e300},
+        {NULL, "-9223372036854777856", false, 0, -9223372036854777856.0},
+        /* rounds to the double -2^63, which is an integer again */
+        {NULL, "-9223372036854775809", true, LLONG_MIN, 0},
+        {"float1", "1.2", false, 0, 1.2},
+        {"float2", "21123456789123.33237", false, 0, 21123456789123.33237},
+        {"float3", "123.100232133", false, 0, 123.100232133},
+        /* beyond the fast path */
+        {NULL, "1.2345678901234567e-200", false, 0, 1.2345678901234567e-200},
+        {NULL, "2.2250738585072014e-308", false, 0, 2.2250738585072014e-308},
+        /* truncated just above a halfway point, left to strtod() */
+        {NULL, "1.000000000000000111022302462515654042363166809082031251", false, 0,
+               1.000000000000000111022302462515654042363166809082031251},
+    };
+    for (size_t i=0; i < sizeof(number_case)/sizeof(number_case[0]); ++i){
+        jscon_item_t *number = jscon_parse_len(number_case[i].text, strlen(number_case[i].text));
+        jscon_item_t *fixture_number = (NULL != number_case[i].key)
+                                        ? jscon_get_branch(root, number_case[i].key)
+                                        : NULL;
+        if (number_case[i].is_integer){
+            assert(jscon_intcmp(number, number_case[i].i_number));
+            assert(NULL == fixture_number || jscon_intcmp(fixture_number, number_case[i].i_number));
+        } else {
+            assert(jscon_doublecmp(number, number_case[i].d_number));
+            assert(NULL == fixture_number || jscon_doublecmp(fixture_number, number_case[i].d_number));
+        }
+        jscon_destroy(number);
+    }
+
+    /* keys and strings decode the same whether parsed to the heap, to an
+     *  arena or in-situ. surrogate pairs join into a single code point,
+     *  surrogates left unpaired become U+FFFD */
+    const struct {
+        const char *text;
+        const char *decoded;
+    } escape_case[] = {
+        {"a\\\"b\\\\c\\/d", "a\"b\\c/d"},
+        {"\\b\\f\\n\\r\\t", "\b\f\n\r\t"},
+        {"\\u0041\\u00e9\\u20AC", "A\xC3\xA9\xE2\x82\xAC"},
+        {"\\ud83d\\ude00", "\xF0\x9F\x98\x80"},
+        {"\\ud83dx", "\xEF\xBF\xBDx"},
+        {"\\ude00", "\xEF\xBF\xBD"},
+        {"\\ud83d\\u0041", "\xEF\xBF\xBD" "A"},
+        {"ol\xC3\xA1 \xF0\x9F\x98\x80", "ol\xC3\xA1 \xF0\x9F\x98\x80"},
+    };
+    jscon_arena_t *arena = jscon_arena_init();
+    for (size_t i=0; i < sizeof(escape_case)/sizeof(escape_case[0]); ++i){
+        char escape_text[128];
+        snprintf(escape_text, sizeof(escape_text), "{\"%s\":\"%s\"}", escape_case[i].text, escape_case[i].text);
+        char *escape_copy[2] = {strdup(escape_text), strdup(escape_text)};
+        assert(NULL != escape_copy[0] && NULL != escape_copy[1]);
+
+        jscon_item_t *escape_root[3] = {
+            jscon_parse_len(escape_text, strlen(escape_text)),
+            jscon_parse_arena(arena, escape_copy[0]),
+            jscon_parse_ext(escape_copy[1], NULL, JSCON_PARSE_INSITU),
+        };
+        for (int j=0; j < 3; ++j){
+            jscon_item_t *escape_string = jscon_get_byindex(escape_root[j], 0);
+            assert(0 == strcmp(escape_case[i].decoded, jscon_get_key(escape_string)));
+            assert(0 == strcmp(escape_case[i].decoded, jscon_get_string(escape_string)));
+            assert(escape_string == jscon_get_branch(escape_root[j], escape_case[i].decoded));
+        }
+        jscon_destroy(escape_root[0]);
+        jscon_destroy(escape_root[2]);
+        free(escape_copy[0]);
+        free(escape_copy[1]);
+    }
+    jscon_arena_destroy(arena);
+
+    /* ill-formed UTF-8 is rejected: overlong forms, encoded surrogates,
+     *  code points past U+10FFFF, stray continuation bytes and cut short
+     *  sequences */
+    const char *utf8_text[] = {
+        "\"\xC0\xAF\"",
+        "\"\xE0\x80\xAF\"",
+        "\"\xED\xA0\x80\"",
+        "\"\xF4\x90\x80\x80\"",
+        "\"\x80\"",
+        "\"\xE2\x82\"",
+    };
+    for (size_t i=0; i < sizeof(utf8_text)/sizeof(utf8_text[0]); ++i){
+        assert(-1 != jscon_validate(utf8_text[i], strlen(utf8_text[i])));
+    }
+
+    /* quotes, backslashes and control chars in keys and strings are
+     *  escaped by jscon_stringify(), and decode back to themselves */
+    jscon_item_t *escape_object = jscon_object(NULL);
+    jscon_append(escape_object, jscon_string("k\"\\\n\x01", "v\"\\\t\x1f"));
+    char *escape_buffer = jscon_stringify(escape_object, JSCON_ANY);
+    assert(NULL != escape_buffer);
+    assert(-1 == jscon_validate(escape_buffer, strlen(escape_buffer)));
+    jscon_item_t *escape_parsed = jscon_parse_len(escape_buffer, strlen(escape_buffer));
+    jscon_item_t *escape_string = jscon_get_byindex(escape_parsed, 0);
+    assert(0 == strcmp("k\"\\\n\x01", jscon_get_key(escape_string)));
+    assert(0 == strcmp("v\"\\\t\x1f", jscon_get_string(escape_string)));
+    free(escape_buffer);
+    jscon_destroy(escape_parsed);
+    jscon_destroy(escape_object);
+
+    /* top-level numbers may start with a zero */
+    const char *zero_text[] = {"0", "0.5", "-0"};
+    const double zero_value[] = {0.0, 0.5, 0.0};
+    doc = jscon_doc_init();
+    for (size_t i=0; i < sizeof(zero_text)/sizeof(zero_text[0]); ++i){
+        jscon_item_t *number[2] = {
+            jscon_parse_len(zero_text[i], strlen(zero_text[i])),
+            jscon_parse_into(doc, zero_text[i], strlen(zero_text[i])),
+        };
+        for (int j=0; j < 2; ++j){
+            assert(jscon_typecmp(number[j], JSCON_INTEGER|JSCON_DOUBLE));
+            double value = jscon_typecmp(number[j], JSCON_INTEGER)
+                            ? (double)jscon_get_integer(number[j])
+                            : jscon_get_double(number[j]);
+            assert(zero_value[i] == value);
+        }
+        jscon_destroy(number[0]);
+    }
+    jscon_doc_destroy(doc);
+
+    /* objects up to 8 keys are scanned, larger ones looked up through
+     *  their hashtable, which is kept up to date by appends once built */
+    for (long num_key=8; num_key <= 9; ++num_key){
+        char small_text[128];
+        size_t small_len = 0;
+        small_text[small_len++] = '{';
+        for (long i=0; i < num_key; ++i){
+            small_len += sprintf(small_text + small_len, "%s\"k%ld\":%ld", i ? "," : "", i, i);
+        }
+        small_text[small_len++] = '}';
+        small_text[small_len] = '\0';
+
+        jscon_item_t *small_root = jscon_parse(small_text);
+        for (long i=0; i < num_key + 2; ++i){
+            char key[8];
+            if (i >= num_key){ /* the 9th key crosses the scan limit */
+                sprintf(key, "k%ld", i);
+                jscon_append(small_root, jscon_integer(key, i));
+            }
+            for (long j=0; j <= i; ++j){
+                sprintf(key, "k%ld", j);
+                jscon_item_t *small_branch = jscon_get_branch(small_root, key);
+                assert(jscon_intcmp(small_branch, j));
+                assert(small_branch == jscon_get_branch(small_root, jscon_get_key(small_branch)));
+            }
+            assert(NULL == jscon_get_branch(small_root, "k"));
+            assert(NULL == jscon_get_branch(small_root, "k11"));
+        }
+        jscon_destroy(small_root);
+    }
+
+    /* positions stay right through random appends and dettaches, well
+     *  past the dettaches that have branches renumbered */
+    srand(1234);
+    jscon_item_t *shuffle_root[2] = {jscon_array(NULL), jscon_object(NULL)};
+    long shuffle_value[2][160];
+    size_t num_shuffle = 0;
+    long next_value = 0;
+    for (int step=0; step < 160; ++step){
+        if (step < 100 || 0 == num_shuffle || 0 == rand() % 4){
+            char key[16];
+            sprintf(key, "o%ld", next_value);
+            jscon_append(shuffle_root[0], jscon_integer(NULL, next_value));
+            jscon_append(shuffle_root[1], jscon_integer(key, next_value));
+            shuffle_value[0][num_shuffle] = shuffle_value[1][num_shuffle] = next_value++;
+            ++num_shuffle;
+        } else {
+            for (int j=0; j < 2; ++j){
+                size_t pos = rand() % num_shuffle;
+                jscon_destroy(jscon_dettach(jscon_get_byindex(shuffle_root[j], pos)));
+                memmove(&shuffle_value[j][pos], &shuffle_value[j][pos+1], (num_shuffle - pos - 1) * sizeof(long));
+            }
+            --num_shuffle;
+        }
+        if (step < 99) continue;
+
+        for (int j=0; j < 2; ++j){
+            assert(num_shuffle == jscon_size(shuffle_root[j]));
+            for (size_t i=0; i < num_shuffle; ++i){
+                jscon_item_t *shuffle_it = jscon_get_byindex(shuffle_root[j], i);
+                assert(jscon_intcmp(shuffle_it, shuffle_value[j][i]));
+                assert(jscon_get_byindex(shuffle_root[j], i+1) == jscon_get_sibling(shuffle_it, 1));
+                assert((0 == i ? NULL : jscon_get_byindex(shuffle_root[j], i-1)) == jscon_get_sibling(shuffle_it, (size_t)-1));
+
+                char key[16];
+                if (0 == j){
+                    sprintf(key, "%zu", i);
+                    char key_buf[16];
+                    assert(0 == strcmp(key, jscon_get_key_r(shuffle_it, key_buf, sizeof(key_buf))));
+                } else {
+                    sprintf(key, "o%ld", shuffle_value[j][i]);
+                }
+                assert((long)i == jscon_get_index(shuffle_root[j], key));
+                assert(shuffle_it == jscon_get_branch(shuffle_root[j], key));
+            }
+        }
+    }
+    jscon_destroy(shuffle_root[0]);
+    jscon_destroy(shuffle_root[1]);
+
+    /* clones hold the same document, and find keys through their own
+     *  copy of the hashtables */
+    jscon_build_index(root);
+    arena = jscon_arena_init();
+    jscon_item_t *clone[2] = {jscon_clone(root), jscon_clone_arena(arena, root)};
+    for (int i=0; i < 2; ++i){
+        char *clone_buffer = jscon_stringify(clone[i], JSCON_ANY);
+        assert(NULL != clone_buffer);
+        assert(0 == strcmp(buffer, clone_buffer));
+        free(clone_buffer);
+
+        jscon_item_t *clone_it = clone[i];
+        for (jscon_item_t *it = root; NULL != it; it = jscon_iter_next(it)){
+            if (it != root && jscon_typecmp(jscon_get_parent(it), JSCON_OBJECT)){
+                assert(clone_it == jscon_get_branch(jscon_get_parent(clone_it), jscon_get_key(it)));
+            }
+            clone_it = jscon_iter_next(clone_it);
+        }
+        assert(NULL == clone_it);
+    }
+    jscon_destroy(clone[0]);
+    jscon_arena_destroy(arena);
+    free(buffer);
+
+    /* a double is copied bit for bit */
+    jscon_item_t *d_number = jscon_double(NULL, 0.1 + 0.2);
+    jscon_item_t *d_clone = jscon_clone(d_number);
+    assert(jscon_get_double(d_clone) == jscon_get_double(d_number));
+    jscon_destroy(d_clone);
+    jscon_destroy(d_number);
+
+    /* records are all delivered, in input order unless told otherwise */
+    const long num_record = 20000;
+    size_t ndjson_len = 0;
+    char *ndjson = malloc(num_record * 64);
+    assert(NULL != ndjson);
+    for (long i=0; i < num_record; ++i){
+        ndjson_len += sprintf(ndjson + ndjson_len, "{\"id\":%ld,\"name\":\"record%ld\",\"tags\":[1,2,3]}\n", i, i);
+    }
+    long next_record = 0;
+    jscon_parse_many(ndjson, ndjson_len, 4, JSCON_PARSE_DEFAULT, &check_record_order, &next_record);
+    assert(num_record == next_record);
+
+    char *seen_record = calloc(num_record, 1);
+    assert(NULL != seen_record);
+    jscon_parse_many(ndjson, ndjson_len, 4, JSCON_PARSE_UNORDERED, &mark_record, seen_record);
+    for (long i=0; i < num_record; ++i){
+        assert(1 == seen_record[i]);
+    }
+    free(seen_record);
+
+    /* interned keys are shared by every document parsed with the flag,
+     *  from any thread, and left alone when a document is destroyed */
+    jscon_item_t *intern_root[2] = {
+        jscon_parse_ext(json_text, NULL, JSCON_PARSE_INTERN),
+        jscon_parse_ext(json_text, NULL, JSCON_PARSE_INTERN),
+    };
+    jscon_iter_t intern_iter[2];
+    jscon_iter_init(&intern_iter[0], intern_root[0], JSCON_ITER_ALL);
+    jscon_iter_init(&intern_iter[1], intern_root[1], JSCON_ITER_ALL);
+    const char *intern_key = NULL;
+    for (jscon_item_t *it = jscon_iter_step(&intern_iter[0]); NULL != it; it = jscon_iter_step(&intern_iter[0])){
+        jscon_item_t *intern_twin = jscon_iter_step(&intern_iter[1]);
+        if (it != intern_root[0] && jscon_typecmp(jscon_get_parent(it), JSCON_OBJECT)){
+            assert(jscon_get_key(it) == jscon_get_key(intern_twin));
+            assert(it == jscon_get_branch(jscon_get_parent(it), jscon_get_key(it)));
+            if (NULL == intern_key){
+                intern_key = jscon_get_key(it);
+            }
+        }
+    }
+    buffer = jscon_stringify(root, JSCON_ANY);
+    assert(NULL != buffer);
+    char *intern_buffer = jscon_stringify(intern_root[0], JSCON_ANY);
+    assert(NULL != intern_buffer);
+    assert(0 == strcmp(buffer, intern_buffer));
+    free(intern_buffer);
+    free(buffer);
+    jscon_destroy(intern_root[0]);
+    jscon_destroy(intern_root[1]);
+    intern_root[0] = jscon_parse_ext(json_text, NULL, JSCON_PARSE_INTERN);
+    jscon_iter_init(&intern_iter[0], intern_root[0], JSCON_ITER_ALL);
+    for (jscon_item_t *it = jscon_iter_step(&intern_iter[0]); NULL != it; it = jscon_iter_step(&intern_iter[0])){
+        if (it != intern_root[0] && jscon_typecmp(jscon_get_parent(it), JSCON_OBJECT)){
+            assert(intern_key == jscon_get_key(it));
+            break;
+        }
+    }
+    jscon_destroy(intern_root[0]);
+
+    char intern_text[] = "{\"id\":0,\"name\":\"record0\",\"tags\":[]}";
+    jscon_item_t *intern_record = jscon_parse_ext(intern_text, NULL, JSCON_PARSE_INTERN);
+    jscon_parse_many(ndjson, ndjson_len, 4, JSCON_PARSE_INTERN, &check_interned_keys, intern_record);
+    jscon_parse_many(ndjson, ndjson_len, 4, JSCON_PARSE_INTERN|JSCON_PARSE_UNORDERED, &check_interned_keys, intern_record);
+    jscon_destroy(intern_record);
+    free(ndjson);
+
+    /* keys new to a full pool are owned by their document instead */
+    jscon_intern_reset();
+    const long num_intern_key = 70000;
+    size_t keys_len = 0;
+    char *keys_text = malloc(num_intern_key * 32);
+    assert(NULL != keys_text);
+    keys_text[keys_len++] = '{';
+    for (long i=0; i < num_intern_key; ++i){
+        keys_len += sprintf(keys_text + keys_len, "%s\"key%ld\":%ld", i ? "," : "", i, i);
+    }
+    keys_text[keys_len++] = '}';
+    keys_text[keys_len] = '\0';
+    jscon_item_t *keys_root = jscon_parse_ext(keys_text, NULL, JSCON_PARSE_INTERN);
+    assert((size_t)num_intern_key == jscon_size(keys_root));
+    for (long i=0; i < num_intern_key; i += 997){
+        char key[32];
+        sprintf(key, "key%ld", i);
+        assert(jscon_intcmp(jscon_get_branch(keys_root, key), i));
+    }
+    jscon_destroy(keys_root);
+    free(keys_text);
+    jscon_intern_reset();
+
+    /* an array split across threads is stitched back as it was */
+    const long num_element = 20000;
+    size_t array_len = 0;
+    char *array_text = malloc(num_element * 64);
+    assert(NULL != array_text);
+    array_text[array_len++] = '[';
+    for (long i=0; i < num_element; ++i){
+        const char *sep = (i + 1 < num_element) ? "," : "]";
+        switch (i % 4){
+        case 0: array_len += sprintf(array_text + array_len, "{\"id\":%ld,\"sub\":[%ld,{}]}%s", i, i, sep); break;
+        case 1: array_len += sprintf(array_text + array_len, "[%ld, [], \"e%ld\"] %s", i, i, sep); break;
+        case 2: array_len += sprintf(array_text + array_len, "\"s,%ld]\"%s", i, sep); break;
+        default: array_len += sprintf(array_text + array_len, "%ld.5%s", i, sep); break;
+        }
+    }
+    jscon_item_t *parallel_root = jscon_parse_parallel(array_text, array_len, 4);
+    jscon_item_t *serial_root = jscon_parse(array_text);
+    char *parallel_buffer = jscon_stringify(parallel_root, JSCON_ANY);
+    char *serial_buffer = jscon_stringify(serial_root, JSCON_ANY);
+    assert(NULL != parallel_buffer && NULL != serial_buffer);
+    assert(num_element == (long)jscon_size(parallel_root));
+    assert(0 == strcmp(serial_buffer, parallel_buffer));
+    free(serial_buffer);
+    free(parallel_buffer);
+    jscon_destroy(serial_root);
+    jscon_destroy(parallel_root);
+    free(array_text);
+
+    /* appending one at a time yields the same as parsing */
+    jscon_item_t *array = jscon_array(NULL);
+    assert(jscon_reserve(array, 10));
+    for (long long i=0; i < 1000; ++i){
+        jscon_item_t *object = jscon_object(NULL);
+        for (long long j=0; j < i % 20; ++j){
+            char key[32];
+            snprintf(key, sizeof(key), "key%lld", j);
+            assert(NULL != jscon_append(object, jscon_integer(key, i * j)));
+            assert(jscon_get_branch(object, key) == jscon_get_byindex(object, j));
+        }
+        assert(NULL != jscon_append(array, object));
+    }
+    /* element keys are their positions, and outlive the next call
+     *  when written to a buffer of the caller's */
+    char key_a[21], key_b[21];
+    assert(0 == strcmp("7", jscon_get_key_r(jscon_get_byindex(array, 7), key_a, sizeof(key_a))));
+    assert(0 == strcmp("8", jscon_get_key_r(jscon_get_byindex(array, 8), key_b, sizeof(key_b))));
+    assert(0 != strcmp(key_a, key_b));
+    assert(jscon_keycmp(jscon_get_byindex(array, 999), "999"));
+    buffer = jscon_stringify(array, JSCON_ANY);
+    assert(NULL != buffer);
+    jscon_item_t *parsed_array = jscon_parse(buffer);
+    assert(jscon_size(parsed_array) == jscon_size(array));
+    char *parsed_buffer = jscon_stringify(parsed_array, JSCON_ANY);
+    assert(0 == strcmp(buffer, parsed_buffer));
+    free(parsed_buffer);
+    free(buffer);
+    jscon_destroy(parsed_array);
+    jscon_destroy(array);
+
     jscon_item_t *property1 = jscon_dettach(jscon_get_branch(root, "author"));
 
     if (NULL != property1){
@@ -204,3 +740,99 @@ jscon_item_t *callback_test(jscon_item_t *item)
       
     return item;
 }
+
+/* prune every "id" and "user" property */
+jscon_item_t *prune_callback(jscon_item_t *item)
+{
+    if (jscon_keycmp(item, "id") || jscon_keycmp(item, "user")){
+        return NULL;
+    }
+
+    return item;
+}
+
+bool points_into(const char *ptr, const char *buffer, size_t len){
+    return ptr >= buffer && ptr < buffer + len;
+}
+
+void count_value(void *data){
+    ++*(size_t*)data;
+}
+
+void count_string(const char *string, size_t len, void *data){
+    (void)string; (void)len;
+    ++*(size_t*)data;
+}
+
+void count_number(enum jscon_type type, long long i_number, double d_number, void *data){
+    (void)type; (void)i_number; (void)d_number;
+    ++*(size_t*)data;
+}
+
+void count_boolean(bool boolean, void *data){
+    (void)boolean;
+    ++*(size_t*)data;
+}
+
+void compare_tape(jscon_item_t *item, jscon_view_t view)
+{
+    assert(jscon_get_type(item) == jscon_view_get_type(view));
+
+    switch (jscon_get_type(item)){
+    case JSCON_OBJECT:
+    case JSCON_ARRAY:
+     {
+        assert(jscon_size(item) == jscon_view_size(view));
+
+        jscon_view_t branch = jscon_view_first(view);
+        for (size_t i=0; i < jscon_size(item); ++i){
+            jscon_item_t *tmp = jscon_get_byindex(item, i);
+            if (JSCON_OBJECT == jscon_get_type(item)){
+                assert(0 == strcmp(jscon_get_key(tmp), jscon_view_get_key(branch)));
+            }
+            compare_tape(tmp, branch);
+            branch = jscon_view_next(branch);
+        }
+        assert(JSCON_UNDEFINED == jscon_view_get_type(branch));
+        break;
+     }
+    case JSCON_STRING:
+        assert(0 == strcmp(jscon_get_string(item), jscon_view_get_string(view, NULL)));
+        break;
+    case JSCON_INTEGER:
+        assert(jscon_get_integer(item) == jscon_view_get_integer(view));
+        break;
+    case JSCON_DOUBLE:
+        assert(jscon_get_double(item) == jscon_view_get_double(view));
+        break;
+    case JSCON_BOOLEAN:
+        assert(jscon_get_boolean(item) == jscon_view_get_boolean(view));
+        break;
+    default:
+        break;
+    }
+}
+
+void check_record_order(jscon_item_t *root, void *data)
+{
+    long *p_next_record = data;
+    assert(jscon_intcmp(jscon_get_branch(root, "id"), *p_next_record));
+    ++*p_next_record;
+}
+
+/* records are marked by id, each one is written by a single thread */
+void mark_record(jscon_item_t *root, void *data)
+{
+    char *seen_record = data;
+    ++seen_record[jscon_get_integer(jscon_get_branch(root, "id"))];
+}
+
+/* record keys are the pool's copies, the same as the sample record's */
+void check_interned_keys(jscon_item_t *root, void *data)
+{
+    jscon_item_t *sample = data;
+    for (size_t i=0; i < jscon_size(root); ++i){
+        jscon_item_t *branch = jscon_get_byindex(root, i);
+        assert(jscon_get_key(branch) == jscon_get_key(jscon_get_branch(sample, jscon_get_key(branch))));
+    }
+}